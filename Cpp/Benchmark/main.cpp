@@ -0,0 +1,846 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <random>
+#include <functional>
+#include <thread>
+#include <cstring>
+#include <assert.h>
+
+#include "glm/glm.hpp"
+#include "glm/ext.hpp"
+#include "assimp/Importer.hpp"
+#include "assimp/postprocess.h"
+#include "assimp/scene.h"
+#include "spdlog/spdlog.h"
+
+#include "Benchmark.hpp"
+#include "Util.hpp"
+#include "Rect.hpp"
+#include "Renderer.hpp"
+#include "Camera.hpp"
+#include "ModelShader.hpp"
+#include "ModelShader2.hpp"
+#include "DepthShader.hpp"
+#include "RenderPipeLine.hpp"
+#include "Texture2D.hpp"
+#include "Mesh.hpp"
+#include "CommandBuffer.hpp"
+#include "JobSystem.hpp"
+#include "PostProcess.hpp"
+#include "DynamicResolution.hpp"
+#include "TileCache.hpp"
+
+struct BenchmarkResult
+{
+	std::string name;
+	std::string unit;
+	long long iterations = 0;
+	double nsPerOp = 0.0;
+	double throughput = 0.0;
+};
+
+struct FlatVertex
+{
+	glm::vec3 position;
+	glm::vec3 color;
+};
+
+class FlatShader : public Shader
+{
+public:
+	virtual RasterizationData vertexShader(const void * vertexBuffer, const int vertexIdx) override
+	{
+		const FlatVertex vertex = ((const FlatVertex*)vertexBuffer)[vertexIdx];
+		RasterizationData out;
+		out.position = glm::vec4(vertex.position, 1.0f);
+		out.extraData.push_back(glm::vec4(vertex.color, 1.0f));
+		return out;
+	}
+
+	virtual glm::vec4 fragmentShader(const RasterizationData & rasterizationData) override
+	{
+		return rasterizationData.extraData[0];
+	}
+};
+
+/*
+Accumulates results so the optimizer can not drop the measured work.
+*/
+volatile double benchmarkSink = 0.0;
+
+double minSecondsPerCase = 0.5;
+
+/*
+Runs op until at least minSecondsPerCase has elapsed. itemsPerOp is the number of triangles or pixels one op processes,
+scaled to millions per second; pass 0 to report only ns/op.
+*/
+BenchmarkResult measure(const std::string& name, const std::string& unit, const double itemsPerOp, const std::function<void()>& op)
+{
+	op();
+
+	long long iterations = 0;
+	long long batch = 1;
+	Benchmark benchmark = Benchmark::run();
+	while (benchmark.durationSec() < minSecondsPerCase)
+	{
+		for (long long i = 0; i < batch; i++)
+		{
+			op();
+		}
+		iterations += batch;
+		batch *= 2;
+	}
+	const double seconds = benchmark.durationSec();
+
+	BenchmarkResult result;
+	result.name = name;
+	result.unit = unit;
+	result.iterations = iterations;
+	result.nsPerOp = seconds * 1e9 / (double)iterations;
+	result.throughput = itemsPerOp > 0.0 ? itemsPerOp * iterations / seconds / 1e6 : 0.0;
+	if (result.throughput > 0.0)
+	{
+		spdlog::info("{:<32} {:>14.1f} ns/op {:>10.3f} {}", name, result.nsPerOp, result.throughput, unit);
+	}
+	else
+	{
+		spdlog::info("{:<32} {:>14.1f} ns/op", name, result.nsPerOp);
+	}
+	return result;
+}
+
+int countCoveredPixels(const FrameBuffer& frameBuffer)
+{
+	const unsigned char* data = frameBuffer.getData();
+	const int length = frameBuffer.getWidth() * frameBuffer.getHeight();
+	int count = 0;
+	for (int i = 0; i < length; i++)
+	{
+		if (data[i * 3] != 0)
+		{
+			count++;
+		}
+	}
+	return count;
+}
+
+void benchmarkSetup(std::vector<BenchmarkResult>& results, Renderer& renderer)
+{
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	const int triangleCount = 1024;
+	std::vector<glm::vec4> positions;
+	for (int i = 0; i < triangleCount * 3; i++)
+	{
+		positions.push_back(glm::vec4(dist(random), dist(random), 0.5f, 1.0f));
+	}
+
+	results.push_back(measure("triangle setup", "Mtri/s", triangleCount, [&]() {
+		double sum = 0.0;
+		for (int i = 0; i < triangleCount; i++)
+		{
+			const glm::vec4 a = divideByW(positions[i * 3 + 0]);
+			const glm::vec4 b = divideByW(positions[i * 3 + 1]);
+			const glm::vec4 c = divideByW(positions[i * 3 + 2]);
+			if (renderer.isValidTriangle(a, b, c))
+			{
+				const Rect box = Rect::boundingBox(a, b, c);
+				sum += box.width + box.height;
+			}
+		}
+		benchmarkSink = benchmarkSink + sum;
+	}));
+}
+
+void benchmarkCoverage(std::vector<BenchmarkResult>& results, Renderer& renderer)
+{
+	struct CoverageCase
+	{
+		std::string name;
+		glm::vec3 a;
+		glm::vec3 b;
+		glm::vec3 c;
+		int triangleCount;
+	};
+
+	const std::vector<CoverageCase> cases = {
+		{ "coverage tiny", glm::vec3(0.0f, 0.0f, 0.5f), glm::vec3(0.01f, 0.0f, 0.5f), glm::vec3(0.0f, 0.01f, 0.5f), 256 },
+		{ "coverage medium", glm::vec3(-0.2f, -0.2f, 0.5f), glm::vec3(0.2f, -0.2f, 0.5f), glm::vec3(-0.2f, 0.2f, 0.5f), 16 },
+		{ "coverage huge", glm::vec3(-1.0f, -1.0f, 0.5f), glm::vec3(1.0f, -1.0f, 0.5f), glm::vec3(-1.0f, 1.0f, 0.5f), 1 },
+		{ "coverage sliver", glm::vec3(-1.0f, -1.0f, 0.5f), glm::vec3(1.0f, 1.0f, 0.5f), glm::vec3(0.99f, 1.0f, 0.5f), 4 },
+	};
+
+	FlatShader shader;
+	for (const CoverageCase& coverageCase : cases)
+	{
+		std::vector<FlatVertex> vertexBuffer;
+		for (int i = 0; i < coverageCase.triangleCount; i++)
+		{
+			vertexBuffer.push_back({ coverageCase.a, Color::white });
+			vertexBuffer.push_back({ coverageCase.b, Color::white });
+			vertexBuffer.push_back({ coverageCase.c, Color::white });
+		}
+
+		RenderPipeline pipeline;
+		pipeline.shader = &shader;
+		pipeline.depthStencil.depthCompare = CompareOp::always;
+		pipeline.vertexBuffer = static_cast<void*>(vertexBuffer.data());
+		pipeline.triangleCount = coverageCase.triangleCount;
+
+		RenderPipeline single = pipeline;
+		single.triangleCount = 1;
+		renderer.flush();
+		renderer.pipeline(single);
+		const int pixelsPerTriangle = countCoveredPixels(*renderer.getFrameBuffer());
+
+		// The cases draw over and over without a flush. Each draw rewinds the frame arena when it ends, so the arena stays
+		// at its first block; the flush before each case only keeps the previous case's frame out of the timing.
+		renderer.flush();
+		results.push_back(measure(coverageCase.name + " (tri)", "Mtri/s", coverageCase.triangleCount, [&]() {
+			renderer.pipeline(pipeline);
+		}));
+		renderer.flush();
+		results.push_back(measure(coverageCase.name + " (pix)", "Mpix/s", (double)pixelsPerTriangle * coverageCase.triangleCount, [&]() {
+			renderer.pipeline(pipeline);
+		}));
+	}
+}
+
+void benchmarkInterpolation(std::vector<BenchmarkResult>& results)
+{
+	const glm::vec2 a(-0.5f, -0.5f);
+	const glm::vec2 b(0.5f, -0.5f);
+	const glm::vec2 c(0.0f, 0.5f);
+	const glm::vec4 c0(1.0f, 0.0f, 0.0f, 1.0f);
+	const glm::vec4 c1(0.0f, 1.0f, 0.0f, 1.0f);
+	const glm::vec4 c2(0.0f, 0.0f, 1.0f, 1.0f);
+	const int sampleCount = 1024;
+	std::vector<BarycentricTestResult> tests;
+	for (int i = 0; i < sampleCount; i++)
+	{
+		const double t = (double)i / sampleCount;
+		tests.push_back(BarycentricTestResult::test(a, b, c, t - 0.5, t * 0.5 - 0.25));
+	}
+
+	results.push_back(measure("barycentric test", "Mpix/s", sampleCount, [&]() {
+		double sum = 0.0;
+		for (int i = 0; i < sampleCount; i++)
+		{
+			const double t = (double)i / sampleCount;
+			sum += BarycentricTestResult::test(a, b, c, t - 0.5, t * 0.5 - 0.25).w1;
+		}
+		benchmarkSink = benchmarkSink + sum;
+	}));
+
+	results.push_back(measure("vec4Correction", "Mpix/s", sampleCount, [&]() {
+		double sum = 0.0;
+		for (const BarycentricTestResult& test : tests)
+		{
+			sum += vec4Correction(c0, c1, c2, 2.0, 3.0, 5.0, test).x;
+		}
+		benchmarkSink = benchmarkSink + sum;
+	}));
+}
+
+void benchmarkTexture(std::vector<BenchmarkResult>& results, const std::string& resourceFolder)
+{
+	const Texture2D texture(resourceFolder + "/test0.jpg");
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+	const int sampleCount = 4096;
+	std::vector<glm::vec2> uvs;
+	for (int i = 0; i < sampleCount; i++)
+	{
+		uvs.push_back(glm::vec2(dist(random), dist(random)));
+	}
+
+	results.push_back(measure("Texture2D::sample", "Mpix/s", sampleCount, [&]() {
+		double sum = 0.0;
+		for (const glm::vec2& uv : uvs)
+		{
+			sum += texture.sample(uv).r;
+		}
+		benchmarkSink = benchmarkSink + sum;
+	}));
+}
+
+void benchmarkFrameBuffer(std::vector<BenchmarkResult>& results, Renderer& renderer)
+{
+	const double pixelCount = (double)renderer.getWidth() * renderer.getHeight();
+	results.push_back(measure("FrameBuffer::clear", "Mpix/s", pixelCount, [&]() {
+		renderer.clear(Color::blue);
+	}));
+	results.push_back(measure("FrameBuffer::flush", "Mpix/s", pixelCount, [&]() {
+		renderer.flush();
+	}));
+
+	// A noisy frame, so FXAA finds edges everywhere instead of taking its early out.
+	std::mt19937 random(7);
+	unsigned char* data = renderer.mutableFrameBuffer()->mutableData();
+	for (int i = 0; i < renderer.getWidth() * renderer.getHeight() * 3; i++)
+	{
+		data[i] = (unsigned char)(random() & 0xff);
+	}
+	const FrameBuffer& frame = *renderer.getFrameBuffer();
+	ToneMapEffect toneMapEffect;
+	GammaEffect gammaEffect;
+	FxaaEffect fxaaEffect;
+	GaussianBlurEffect blurEffect;
+	DownsampleEffect downsampleEffect;
+	struct PostCase
+	{
+		std::string name;
+		std::vector<PostProcessEffect*> effects;
+	};
+	const std::vector<PostCase> postCases = {
+		{ "post tonemap+gamma", { &toneMapEffect, &gammaEffect } },
+		{ "post fxaa", { &fxaaEffect } },
+		{ "post blur", { &blurEffect } },
+		{ "post downsample", { &downsampleEffect } },
+	};
+	for (const PostCase& postCase : postCases)
+	{
+		PostProcessChain chain;
+		for (PostProcessEffect* effect : postCase.effects)
+		{
+			chain.add(effect);
+		}
+		const glm::ivec2 outputSize = chain.getOutputSize(glm::ivec2(frame.getWidth(), frame.getHeight()));
+		FrameBuffer target(outputSize.x, outputSize.y);
+		results.push_back(measure(postCase.name, "Mpix/s", pixelCount, [&]() {
+			chain.run(frame, target);
+		}));
+	}
+
+	// Dynamic resolution at its lowest default level: a half size frame scaled back up.
+	FrameBuffer halfFrame(std::max(1, frame.getWidth() / 2), std::max(1, frame.getHeight() / 2));
+	FrameBuffer upscaled(frame.getWidth(), frame.getHeight());
+	results.push_back(measure("upscale 2x bilinear", "Mpix/s", pixelCount, [&]() {
+		upscale(halfFrame, upscaled, UpscaleFilter::bilinear);
+	}));
+	results.push_back(measure("upscale 2x edge aware", "Mpix/s", pixelCount, [&]() {
+		upscale(halfFrame, upscaled, UpscaleFilter::edgeAware);
+	}));
+}
+
+void benchmarkScenes(std::vector<BenchmarkResult>& results, Renderer& renderer, const std::string& resourceFolder)
+{
+	FCamera camera = FCamera(renderer.getWidth(), renderer.getHeight());
+	camera.MoveBack(1.0);
+	const glm::mat4x4 translateMat = glm::translate(glm::mat4x4(1.0), glm::vec3(0.0f, 0.0, 5.0));
+	const glm::mat4x4 rotateMat = glm::rotate(glm::mat4x4(1.0), glm::radians(30.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+	const glm::mat4x4 modelMat = translateMat * rotateMat;
+
+	{
+		Assimp::Importer importer;
+		const aiScene* scene = importer.ReadFile(resourceFolder + "/box.dae", (aiProcess_Triangulate | aiProcess_JoinIdenticalVertices));
+		assert(scene);
+		Mesh* mesh = Mesh::fromScene<BaseVertex>(scene, [](const aiMesh* mesh, const aiMaterial* material, unsigned int index) {
+			aiColor4D diffuseColor;
+			material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuseColor);
+			const aiVector3D vertex = mesh->mVertices[index];
+			BaseVertex baseVertex;
+			baseVertex.position = glm::vec3(vertex.x, vertex.y, vertex.z);
+			baseVertex.color = glm::vec3(diffuseColor.r, diffuseColor.g, diffuseColor.b);
+			return baseVertex;
+		});
+
+		ModelShader shader;
+		shader.modelMat = modelMat;
+		shader.viewMat = camera.GetViewMat();
+		shader.projectionMat = camera.GetprojectionMat();
+		RenderPipeline pipeline;
+		pipeline.shader = &shader;
+		pipeline.setMesh(*mesh);
+		results.push_back(measure("pipeline box.dae", "Mtri/s", pipeline.triangleCount, [&]() {
+			renderer.flush();
+			renderer.pipeline(pipeline);
+		}));
+
+		// A stack of boxes behind each other, submitted far to near (worst case for the depth test)
+		// and then through a command buffer that reorders them near to far.
+		const int stackSize = 16;
+		std::vector<glm::mat4x4> stackModelMats;
+		for (int i = stackSize - 1; i >= 0; i--)
+		{
+			stackModelMats.push_back(glm::translate(glm::mat4x4(1.0), glm::vec3(0.0f, 0.0, 5.0f + i * 0.5f)) * rotateMat);
+		}
+		results.push_back(measure("box stack far to near", "Mtri/s", pipeline.triangleCount * stackSize, [&]() {
+			renderer.flush();
+			for (const glm::mat4x4& stackModelMat : stackModelMats)
+			{
+				shader.modelMat = stackModelMat;
+				renderer.pipeline(pipeline);
+			}
+		}));
+		CommandBuffer commandBuffer;
+		results.push_back(measure("box stack command buffer", "Mtri/s", pipeline.triangleCount * stackSize, [&]() {
+			renderer.flush();
+			commandBuffer.clear();
+			for (const glm::mat4x4& stackModelMat : stackModelMats)
+			{
+				DrawPacket packet;
+				packet.pipeline = pipeline;
+				packet.depth = CommandBuffer::viewDepth(shader.viewMat, glm::vec3(stackModelMat[3]));
+				packet.bindUniforms = [&shader, stackModelMat]() {
+					shader.modelMat = stackModelMat;
+				};
+				commandBuffer.submit(packet);
+			}
+			renderer.execute(commandBuffer);
+		}));
+
+		// The same stack drawn depth only, and as a z-prepass followed by an EQUAL shading pass.
+		DepthShader depthShader;
+		depthShader.viewMat = shader.viewMat;
+		depthShader.projectionMat = shader.projectionMat;
+		RenderPipeline depthPipeline;
+		depthPipeline.shader = &depthShader;
+		depthPipeline.setPositionStream(*mesh);
+		depthPipeline.isDepthOnly = true;
+		results.push_back(measure("box stack depth only", "Mtri/s", pipeline.triangleCount * stackSize, [&]() {
+			renderer.flush();
+			for (const glm::mat4x4& stackModelMat : stackModelMats)
+			{
+				depthShader.modelMat = stackModelMat;
+				renderer.pipeline(depthPipeline);
+			}
+		}));
+		RenderPipeline equalPipeline = pipeline;
+		equalPipeline.depthStencil.depthCompare = CompareOp::equal;
+		equalPipeline.depthStencil.isDepthWriteEnabled = false;
+		results.push_back(measure("box stack z-prepass", "Mtri/s", pipeline.triangleCount * stackSize * 2, [&]() {
+			renderer.flush();
+			for (const glm::mat4x4& stackModelMat : stackModelMats)
+			{
+				depthShader.modelMat = stackModelMat;
+				renderer.pipeline(depthPipeline);
+			}
+			for (const glm::mat4x4& stackModelMat : stackModelMats)
+			{
+				shader.modelMat = stackModelMat;
+				renderer.pipeline(equalPipeline);
+			}
+		}));
+
+		// Every box vertex carries the material colour, so coarse shading leaves the image unchanged.
+		for (const ShadingRate shadingRate : { ShadingRate::rate2x2, ShadingRate::rate4x4 })
+		{
+			RenderPipeline coarsePipeline = pipeline;
+			coarsePipeline.shadingRate = shadingRate;
+			const std::string name = shadingRate == ShadingRate::rate2x2 ? "box stack shading 2x2" : "box stack shading 4x4";
+			results.push_back(measure(name, "Mtri/s", pipeline.triangleCount * stackSize, [&]() {
+				renderer.flush();
+				for (const glm::mat4x4& stackModelMat : stackModelMats)
+				{
+					shader.modelMat = stackModelMat;
+					renderer.pipeline(coarsePipeline);
+				}
+			}));
+		}
+
+		// The stack through a tile cache: frames without changes, and frames where the front box moves back and forth.
+		TileCache tileCache(renderer);
+		int movedFrame = 0;
+		const auto submitStack = [&](const glm::mat4x4& frontOffset) {
+			tileCache.begin();
+			for (size_t i = 0; i < stackModelMats.size(); i++)
+			{
+				const glm::mat4x4 stackModelMat = i + 1 == stackModelMats.size() ? frontOffset * stackModelMats[i] : stackModelMats[i];
+				DrawPacket packet;
+				packet.pipeline = pipeline;
+				packet.bindUniforms = [&shader, stackModelMat]() {
+					shader.modelMat = stackModelMat;
+				};
+				tileCache.submit(packet, TileCache::hashInputs(mesh, stackModelMat, 0));
+			}
+			tileCache.end();
+		};
+		results.push_back(measure("box stack tile cache idle", "Mtri/s", pipeline.triangleCount * stackSize, [&]() {
+			submitStack(glm::mat4x4(1.0f));
+		}));
+		results.push_back(measure("box stack tile cache one moved", "Mtri/s", pipeline.triangleCount * stackSize, [&]() {
+			movedFrame++;
+			submitStack(glm::translate(glm::mat4x4(1.0f), glm::vec3(0.05f * (movedFrame % 2), 0.0f, 0.0f)));
+		}));
+		delete mesh;
+	}
+
+	{
+		Assimp::Importer importer;
+		const aiScene* scene = importer.ReadFile(resourceFolder + "/box_with_texutre.dae", (aiProcess_Triangulate | aiProcess_JoinIdenticalVertices));
+		assert(scene);
+		Mesh* mesh = Mesh::fromScene<BaseVertex2>(scene, [](const aiMesh* mesh, const aiMaterial* material, unsigned int index) {
+			const aiVector3D vertex = mesh->mVertices[index];
+			const aiVector3D coords = mesh->mTextureCoords[0][index];
+			BaseVertex2 baseVertex;
+			baseVertex.position = glm::vec3(vertex.x, vertex.y, vertex.z);
+			baseVertex.textureCoords = glm::vec2(coords.x, coords.y);
+			return baseVertex;
+		});
+
+		Texture2D texture(resourceFolder + "/test0.jpg");
+		ModelShader2 shader;
+		shader.modelMat = modelMat;
+		shader.viewMat = camera.GetViewMat();
+		shader.projectionMat = camera.GetprojectionMat();
+		shader.texture = &texture;
+		RenderPipeline pipeline;
+		pipeline.shader = &shader;
+		pipeline.setMesh(*mesh);
+		results.push_back(measure("pipeline box_with_texutre.dae", "Mtri/s", pipeline.triangleCount, [&]() {
+			renderer.flush();
+			renderer.pipeline(pipeline);
+		}));
+
+		// Thumbnails: independent small renderers sharing the mesh and the texture, one after the other
+		// and then each as its own job.
+		const int thumbnailCount = 16;
+		const int thumbnailSize = 128;
+		FCamera thumbnailCamera = FCamera(thumbnailSize, thumbnailSize);
+		thumbnailCamera.MoveBack(1.0);
+		std::vector<Renderer*> thumbnailRenderers;
+		std::vector<ModelShader2> thumbnailShaders(thumbnailCount);
+		std::vector<RenderPipeline> thumbnailPipelines(thumbnailCount);
+		for (int i = 0; i < thumbnailCount; i++)
+		{
+			thumbnailRenderers.push_back(new Renderer(thumbnailSize, thumbnailSize));
+			ModelShader2& thumbnailShader = thumbnailShaders[i];
+			thumbnailShader.modelMat = translateMat * glm::rotate(glm::mat4x4(1.0), glm::radians(i * 360.0f / thumbnailCount), glm::vec3(0.0f, 1.0f, 0.0f));
+			thumbnailShader.viewMat = thumbnailCamera.GetViewMat();
+			thumbnailShader.projectionMat = thumbnailCamera.GetprojectionMat();
+			thumbnailShader.texture = &texture;
+			thumbnailPipelines[i].shader = &thumbnailShader;
+			thumbnailPipelines[i].setMesh(*mesh);
+		}
+		const auto renderThumbnail = [&](const int i) {
+			thumbnailRenderers[i]->flush();
+			thumbnailRenderers[i]->pipeline(thumbnailPipelines[i]);
+		};
+		results.push_back(measure("thumbnails serial", "Mtri/s", pipeline.triangleCount * thumbnailCount, [&]() {
+			for (int i = 0; i < thumbnailCount; i++)
+			{
+				renderThumbnail(i);
+			}
+		}));
+		results.push_back(measure("thumbnails concurrent", "Mtri/s", pipeline.triangleCount * thumbnailCount, [&]() {
+			JobSystem& jobSystem = JobSystem::get();
+			JobCounter counter;
+			for (int i = 0; i < thumbnailCount; i++)
+			{
+				jobSystem.submit([&renderThumbnail, i]() {
+					renderThumbnail(i);
+				}, &counter);
+			}
+			jobSystem.wait(counter);
+		}));
+		for (Renderer* thumbnailRenderer : thumbnailRenderers)
+		{
+			delete thumbnailRenderer;
+		}
+		delete mesh;
+
+		// Same draw, reading positions and uvs straight out of the assimp arrays through a vertex layout.
+		const aiMesh* sceneMesh = scene->mMeshes[0];
+		std::vector<unsigned int> indices;
+		for (unsigned int i = 0; i < sceneMesh->mNumFaces; i++)
+		{
+			const aiFace& face = sceneMesh->mFaces[i];
+			indices.insert(indices.end(), face.mIndices, face.mIndices + face.mNumIndices);
+		}
+		RenderPipeline layoutPipeline;
+		layoutPipeline.shader = &shader;
+		layoutPipeline.indexBuffer = indices.data();
+		layoutPipeline.vertexCount = sceneMesh->mNumVertices;
+		layoutPipeline.triangleCount = (int)indices.size() / 3;
+		layoutPipeline.vertexLayout.addAttribute(sceneMesh->mVertices, sizeof(aiVector3D), 0, VertexFormat::float3);
+		layoutPipeline.vertexLayout.addAttribute(sceneMesh->mTextureCoords[0], sizeof(aiVector3D), 0, VertexFormat::float2);
+		results.push_back(measure("pipeline box_with_texutre.dae (layout)", "Mtri/s", layoutPipeline.triangleCount, [&]() {
+			renderer.flush();
+			renderer.pipeline(layoutPipeline);
+		}));
+	}
+}
+
+/*
+Renders frameCount frames of moving random triangles through a TileCache and through a plain full redraw, and compares
+colour and depth every frame. Draws mix shading rates and depth tests, one draw moves every third frame, and the draw
+count drops and recovers so removed draws are covered too. Returns false on the first mismatching frame.
+*/
+bool verifyTileCache(const int size, const int frameCount)
+{
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> offsetDist(-0.25f, 0.25f);
+	std::uniform_real_distribution<float> depthDist(0.1f, 0.9f);
+	std::uniform_real_distribution<float> colorDist(0.0f, 1.0f);
+	std::uniform_real_distribution<float> positionDist(-1.0f, 1.0f);
+	const auto randomTranslation = [&]() {
+		return glm::translate(glm::mat4x4(1.0f), glm::vec3(positionDist(random), positionDist(random), 0.0f));
+	};
+
+	std::vector<BaseVertex> vertexBuffer;
+	std::vector<unsigned int> indexBuffer;
+	for (unsigned int i = 0; i < 60; i++)
+	{
+		BaseVertex vertex;
+		vertex.position = glm::vec3(offsetDist(random), offsetDist(random), depthDist(random));
+		vertex.color = glm::vec3(colorDist(random), colorDist(random), colorDist(random));
+		vertexBuffer.push_back(vertex);
+		indexBuffer.push_back(i);
+	}
+	Mesh mesh(vertexBuffer.data(), indexBuffer.data(), sizeof(BaseVertex), (int)vertexBuffer.size(), (int)indexBuffer.size());
+
+	ModelShader shader;
+	shader.viewMat = glm::mat4x4(1.0f);
+	shader.projectionMat = glm::mat4x4(1.0f);
+
+	const int drawCount = 40;
+	std::vector<glm::mat4x4> modelMats;
+	std::vector<RenderPipeline> pipelines;
+	for (int i = 0; i < drawCount; i++)
+	{
+		RenderPipeline pipeline;
+		pipeline.shader = &shader;
+		pipeline.setMesh(mesh);
+		if (i % 5 == 1)
+		{
+			pipeline.shadingRate = ShadingRate::rate2x2;
+		}
+		if (i % 7 == 3)
+		{
+			pipeline.depthStencil.depthCompare = CompareOp::always;
+		}
+		pipelines.push_back(pipeline);
+		modelMats.push_back(randomTranslation());
+	}
+
+	Renderer cachedRenderer(size, size);
+	Renderer fullRenderer(size, size);
+	TileCache tileCache(cachedRenderer);
+	tileCache.clearColor = glm::vec3(0.2f, 0.3f, 0.4f);
+
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		if (frame > 0 && frame % 3 == 0)
+		{
+			modelMats[random() % drawCount] = randomTranslation();
+		}
+		const int count = frame % 10 >= 5 ? drawCount - 5 : drawCount;
+
+		tileCache.begin();
+		for (int i = 0; i < count; i++)
+		{
+			const glm::mat4x4 modelMat = modelMats[i];
+			DrawPacket packet;
+			packet.pipeline = pipelines[i];
+			packet.bindUniforms = [&shader, modelMat]() {
+				shader.modelMat = modelMat;
+			};
+			tileCache.submit(packet, TileCache::hashInputs(&mesh, modelMat, 0));
+		}
+		tileCache.end();
+
+		fullRenderer.flush();
+		fullRenderer.clear(tileCache.clearColor);
+		for (int i = 0; i < count; i++)
+		{
+			shader.modelMat = modelMats[i];
+			fullRenderer.pipeline(pipelines[i]);
+		}
+
+		const FrameBuffer& cached = *cachedRenderer.getFrameBuffer();
+		const FrameBuffer& full = *fullRenderer.getFrameBuffer();
+		const int pixelCount = size * size;
+		int colorMismatches = 0;
+		int depthMismatches = 0;
+		for (int i = 0; i < pixelCount; i++)
+		{
+			for (int channel = 0; channel < 3; channel++)
+			{
+				colorMismatches += cached.getData()[i * 3 + channel] != full.getData()[i * 3 + channel];
+			}
+			depthMismatches += cached.getZBuffer()[i] != full.getZBuffer()[i];
+		}
+		if (colorMismatches > 0 || depthMismatches > 0)
+		{
+			spdlog::error("tile cache frame {} differs from a full redraw: {} colour values, {} depth values", frame, colorMismatches, depthMismatches);
+			return false;
+		}
+	}
+	spdlog::info("tile cache matches a full redraw for {} frames", frameCount);
+	return true;
+}
+
+/*
+Draws a mesh larger than one vertex block from several renderers on plain std::threads, which JobSystem does not own,
+so callers waiting in parallelFor run the vertex blocks of other renderers. Every round is compared against the same
+renderers drawn one after another. Returns false on the first mismatching image.
+*/
+bool verifyConcurrentRenderers(const int size, const int roundCount)
+{
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> positionDist(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> offsetDist(-0.05f, 0.05f);
+	std::uniform_real_distribution<float> depthDist(0.1f, 0.9f);
+	std::uniform_real_distribution<float> colorDist(0.0f, 1.0f);
+
+	// Small triangles keep the check about the vertex stage rather than fill.
+	const int vertexCount = 6000;
+	std::vector<BaseVertex> vertexBuffer;
+	std::vector<unsigned int> indexBuffer;
+	glm::vec2 center;
+	for (int i = 0; i < vertexCount; i++)
+	{
+		if (i % 3 == 0)
+		{
+			center = glm::vec2(positionDist(random), positionDist(random));
+		}
+		BaseVertex vertex;
+		vertex.position = glm::vec3(center.x + offsetDist(random), center.y + offsetDist(random), depthDist(random));
+		vertex.color = glm::vec3(colorDist(random), colorDist(random), colorDist(random));
+		vertexBuffer.push_back(vertex);
+		indexBuffer.push_back((unsigned int)i);
+	}
+	Mesh mesh(vertexBuffer.data(), indexBuffer.data(), sizeof(BaseVertex), vertexCount, vertexCount);
+
+	const int rendererCount = 6;
+	std::vector<Renderer*> renderers;
+	std::vector<ModelShader> shaders(rendererCount);
+	std::vector<RenderPipeline> pipelines(rendererCount);
+	for (int i = 0; i < rendererCount; i++)
+	{
+		renderers.push_back(new Renderer(size, size));
+		shaders[i].modelMat = glm::translate(glm::mat4x4(1.0f), glm::vec3(0.05f * i, 0.0f, 0.0f));
+		shaders[i].viewMat = glm::mat4x4(1.0f);
+		shaders[i].projectionMat = glm::mat4x4(1.0f);
+		pipelines[i].shader = &shaders[i];
+		pipelines[i].setMesh(mesh);
+		pipelines[i].instanceCount = 2;
+	}
+	const auto render = [&](const int i) {
+		renderers[i]->flush();
+		renderers[i]->pipeline(pipelines[i]);
+	};
+
+	const size_t imageBytes = (size_t)size * size * 3;
+	std::vector<std::vector<unsigned char>> expected(rendererCount);
+	for (int i = 0; i < rendererCount; i++)
+	{
+		render(i);
+		const unsigned char* data = renderers[i]->getFrameBuffer()->getData();
+		expected[i].assign(data, data + imageBytes);
+	}
+
+	bool isValid = true;
+	for (int round = 0; round < roundCount && isValid; round++)
+	{
+		std::vector<std::thread> threads;
+		for (int i = 0; i < rendererCount; i++)
+		{
+			threads.emplace_back(render, i);
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+		for (int i = 0; i < rendererCount; i++)
+		{
+			if (memcmp(renderers[i]->getFrameBuffer()->getData(), expected[i].data(), imageBytes) != 0)
+			{
+				spdlog::error("renderer {} drawn from a thread in round {} differs from a serial draw", i, round);
+				isValid = false;
+			}
+		}
+	}
+	for (Renderer* renderer : renderers)
+	{
+		delete renderer;
+	}
+	if (isValid)
+	{
+		spdlog::info("{} renderers on threads match serial draws for {} rounds", rendererCount, roundCount);
+	}
+	return isValid;
+}
+
+void writeJson(const std::vector<BenchmarkResult>& results, std::ostream& out)
+{
+	out << "{" << std::endl;
+	out << "  \"results\": [" << std::endl;
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& result = results[i];
+		out << fmt::format("    {{ \"name\": \"{}\", \"unit\": \"{}\", \"iterations\": {}, \"ns_per_op\": {:.3f}, \"throughput\": {:.6f} }}",
+			result.name, result.unit, result.iterations, result.nsPerOp, result.throughput);
+		out << (i + 1 < results.size() ? "," : "") << std::endl;
+	}
+	out << "  ]" << std::endl;
+	out << "}" << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+	std::string resourceFolder = getFolder(argv[0]);
+	resourceFolder = resourceFolder.empty() ? "Resource" : resourceFolder + "/Resource";
+	std::string jsonPath;
+	int size = 512;
+	int verifyFrameCount = 0;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		const std::string arg = argv[i];
+		const std::string value = argv[i + 1];
+		if (arg == "--json")
+		{
+			jsonPath = value;
+		}
+		else if (arg == "--resource")
+		{
+			resourceFolder = value;
+		}
+		else if (arg == "--size")
+		{
+			size = std::stoi(value);
+		}
+		else if (arg == "--seconds")
+		{
+			minSecondsPerCase = std::stod(value);
+		}
+		else if (arg == "--verify")
+		{
+			verifyFrameCount = std::stoi(value);
+		}
+	}
+
+	// --verify <frames> only runs the checks: the tile cache against a full redraw, and renderers drawing from several
+	// threads against serial draws. Returns non-zero on a mismatch.
+	if (verifyFrameCount > 0)
+	{
+		const bool isTileCacheValid = verifyTileCache(size, verifyFrameCount);
+		const bool areRenderersValid = verifyConcurrentRenderers(size, verifyFrameCount);
+		return isTileCacheValid && areRenderersValid ? 0 : 1;
+	}
+
+	Renderer renderer(size, size);
+	std::vector<BenchmarkResult> results;
+
+	benchmarkSetup(results, renderer);
+	benchmarkCoverage(results, renderer);
+	benchmarkInterpolation(results);
+	benchmarkTexture(results, resourceFolder);
+	benchmarkFrameBuffer(results, renderer);
+	benchmarkScenes(results, renderer, resourceFolder);
+
+	if (jsonPath == "-")
+	{
+		writeJson(results, std::cout);
+	}
+	else if (jsonPath.empty() == false)
+	{
+		std::ofstream f(jsonPath);
+		writeJson(results, f);
+	}
+	return 0;
+}
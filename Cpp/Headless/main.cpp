@@ -0,0 +1,510 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <filesystem>
+#include <algorithm>
+#include <cmath>
+#include <assert.h>
+
+#include "glm/glm.hpp"
+#include "glm/ext.hpp"
+#include "assimp/Importer.hpp"
+#include "assimp/postprocess.h"
+#include "assimp/scene.h"
+#include "spdlog/spdlog.h"
+
+#include "Util.hpp"
+#include "Renderer.hpp"
+#include "Camera.hpp"
+#include "ModelShader.hpp"
+#include "ModelShader2.hpp"
+#include "RenderPipeLine.hpp"
+#include "Texture2D.hpp"
+#include "Mesh.hpp"
+#include "MeshFile.hpp"
+#include "Scene.hpp"
+#include "JobSystem.hpp"
+#include "FrameSink.hpp"
+#include "Profiler.hpp"
+#include "DebugBuffers.hpp"
+#include "PPM.hpp"
+#include "PostProcess.hpp"
+#include "SharedFrame.hpp"
+
+struct HeadlessOptions
+{
+	std::string scenePath;
+	std::string texturePath;
+	std::string output;
+	std::string tracePath;
+	std::string debugBuffersPath;
+	std::string sharedMemoryName;
+	std::vector<std::string> postEffects;
+	ImageFormat format = ImageFormat::png;
+	int width = 800;
+	int height = 800;
+	int frameCount = 60;
+	int copies = 1;
+	bool isOcclusionEnabled = false;
+	int threadCount = 0;
+	bool isPinned = false;
+	double startTime = 0.0;
+	double timeStep = 1.0 / 30.0;
+};
+
+void printUsage()
+{
+	std::cout << "Usage: Headless --scene <file|.srmesh> [options]" << std::endl;
+	std::cout << "  --texture <file>   texture sampled by textured meshes" << std::endl;
+	std::cout << "  --frames <n>       number of frames to render (default 60)" << std::endl;
+	std::cout << "  --start <seconds>  animation time of the first frame (default 0)" << std::endl;
+	std::cout << "  --dt <seconds>     fixed time step between frames (default 1/30)" << std::endl;
+	std::cout << "  --copies <n>       draw n copies of the scene on a grid, frustum culled (default 1)" << std::endl;
+	std::cout << "  --occlusion <0|1>  put an occluder wall in front of the lower half of the grid (default 0)" << std::endl;
+	std::cout << "  --threads <n>      job system threads including the main thread, 0 for all cores (default 0)" << std::endl;
+	std::cout << "  --pin <0|1>        pin job system threads to cores (default 0)" << std::endl;
+	std::cout << "  --width <px>       (default 800)" << std::endl;
+	std::cout << "  --height <px>      (default 800)" << std::endl;
+	std::cout << "  --output <path>    directory, /dev/null, or empty to skip writing" << std::endl;
+	std::cout << "  --format <fmt>     ppm, qoi or png (default png)" << std::endl;
+	std::cout << "  --trace <file>     write a Chrome trace (needs the profiling option)" << std::endl;
+	std::cout << "  --heatmaps <dir>   write overdraw, fragment and tile heatmaps per frame" << std::endl;
+	std::cout << "  --post <list>      comma separated post effects: tonemap, gamma, fxaa, blur, downsample" << std::endl;
+	std::cout << "  --shm <name>       publish every frame in shared memory for local readers, e.g. /software-rendering" << std::endl;
+}
+
+bool parseOptions(int argc, char** argv, HeadlessOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		if (i + 1 >= argc)
+		{
+			return false;
+		}
+		const std::string value = argv[++i];
+		if (arg == "--scene")
+		{
+			options.scenePath = value;
+		}
+		else if (arg == "--texture")
+		{
+			options.texturePath = value;
+		}
+		else if (arg == "--frames")
+		{
+			options.frameCount = std::stoi(value);
+		}
+		else if (arg == "--start")
+		{
+			options.startTime = std::stod(value);
+		}
+		else if (arg == "--dt")
+		{
+			options.timeStep = std::stod(value);
+		}
+		else if (arg == "--copies")
+		{
+			options.copies = std::stoi(value);
+		}
+		else if (arg == "--occlusion")
+		{
+			options.isOcclusionEnabled = value == "1";
+		}
+		else if (arg == "--threads")
+		{
+			options.threadCount = std::stoi(value);
+		}
+		else if (arg == "--pin")
+		{
+			options.isPinned = value == "1";
+		}
+		else if (arg == "--width")
+		{
+			options.width = std::stoi(value);
+		}
+		else if (arg == "--height")
+		{
+			options.height = std::stoi(value);
+		}
+		else if (arg == "--output")
+		{
+			options.output = value;
+		}
+		else if (arg == "--trace")
+		{
+			options.tracePath = value;
+		}
+		else if (arg == "--heatmaps")
+		{
+			options.debugBuffersPath = value;
+		}
+		else if (arg == "--shm")
+		{
+			options.sharedMemoryName = value;
+		}
+		else if (arg == "--post")
+		{
+			size_t start = 0;
+			while (start <= value.size())
+			{
+				const size_t end = std::min(value.find(',', start), value.size());
+				const std::string name = value.substr(start, end - start);
+				if (name != "tonemap" && name != "gamma" && name != "fxaa" && name != "blur" && name != "downsample")
+				{
+					return false;
+				}
+				options.postEffects.push_back(name);
+				start = end + 1;
+			}
+		}
+		else if (arg == "--format")
+		{
+			if (value == "ppm")
+			{
+				options.format = ImageFormat::ppm;
+			}
+			else if (value == "qoi")
+			{
+				options.format = ImageFormat::qoi;
+			}
+			else if (value == "png")
+			{
+				options.format = ImageFormat::png;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return options.scenePath.empty() == false && options.frameCount > 0 && options.copies > 0 && options.width > 0 && options.height > 0;
+}
+
+std::string frameFilename(const HeadlessOptions& options, const int frameIndex)
+{
+	if (options.output == "/dev/null")
+	{
+		return options.output;
+	}
+	const char* extension = "png";
+	switch (options.format)
+	{
+	case ImageFormat::ppm:
+		extension = "ppm";
+		break;
+	case ImageFormat::qoi:
+		extension = "qoi";
+		break;
+	case ImageFormat::png:
+		extension = "png";
+		break;
+	}
+	const std::filesystem::path path = std::filesystem::path(options.output) / fmt::format("frame_{:05d}.{}", frameIndex, extension);
+	return path.string();
+}
+
+int main(int argc, char ** argv)
+{
+	HeadlessOptions options;
+	if (parseOptions(argc, argv, options) == false)
+	{
+		printUsage();
+		return 1;
+	}
+	JobSystem::setup(options.threadCount, options.isPinned);
+	spdlog::info("job system: {} threads", JobSystem::get().getWorkerCount());
+
+	Texture2D* texture = nullptr;
+	if (options.texturePath.empty() == false)
+	{
+		texture = new Texture2D(options.texturePath);
+	}
+
+	// Geometry is static, so it is converted to a Mesh once instead of per frame.
+	// A .srmesh file written by MeshConverter is mapped as is and skips assimp entirely.
+	MeshFile* meshFile = nullptr;
+	Mesh* sceneMesh = nullptr;
+	bool isTextured = false;
+	if (std::filesystem::path(options.scenePath).extension() == ".srmesh")
+	{
+		meshFile = MeshFile::open(options.scenePath);
+		if (meshFile == nullptr || meshFile->getVertexFormat() == MeshVertexFormat::custom)
+		{
+			spdlog::error("Can not load {}", options.scenePath);
+			return 1;
+		}
+		isTextured = texture && meshFile->getVertexFormat() == MeshVertexFormat::baseVertex2;
+		if (texture && isTextured == false)
+		{
+			spdlog::warn("{} has no texture coordinates, --texture ignored", options.scenePath);
+		}
+	}
+	else
+	{
+		Assimp::Importer importer;
+		const aiScene* scene = importer.ReadFile(options.scenePath, (aiProcess_Triangulate | aiProcess_JoinIdenticalVertices));
+		if (scene == nullptr)
+		{
+			spdlog::error("Can not load {}: {}", options.scenePath, importer.GetErrorString());
+			return 1;
+		}
+
+		isTextured = texture && scene->mNumMeshes > 0 && scene->mMeshes[0]->HasTextureCoords(0);
+		if (isTextured)
+		{
+			sceneMesh = Mesh::fromScene<BaseVertex2>(scene, [](const aiMesh* mesh, const aiMaterial* material, unsigned int index) {
+				const aiVector3D vertex = mesh->mVertices[index];
+				const aiVector3D coords = mesh->mTextureCoords[0][index];
+				BaseVertex2 baseVertex;
+				baseVertex.position = glm::vec3(vertex.x, vertex.y, vertex.z);
+				baseVertex.textureCoords = glm::vec2(coords.x, coords.y);
+				return baseVertex;
+			});
+		}
+		else
+		{
+			sceneMesh = Mesh::fromScene<BaseVertex>(scene, [](const aiMesh* mesh, const aiMaterial* material, unsigned int index) {
+				aiColor4D diffuseColor;
+				material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuseColor);
+				const aiVector3D vertex = mesh->mVertices[index];
+				BaseVertex baseVertex;
+				baseVertex.position = glm::vec3(vertex.x, vertex.y, vertex.z);
+				baseVertex.color = glm::vec3(diffuseColor.r, diffuseColor.g, diffuseColor.b);
+				return baseVertex;
+			});
+		}
+	}
+	const Mesh& mesh = meshFile ? meshFile->getMesh() : *sceneMesh;
+
+	ToneMapEffect toneMapEffect;
+	GammaEffect gammaEffect;
+	FxaaEffect fxaaEffect;
+	GaussianBlurEffect blurEffect;
+	DownsampleEffect downsampleEffect;
+	PostProcessChain postProcessChain;
+	for (const std::string& name : options.postEffects)
+	{
+		PostProcessEffect* effect = &toneMapEffect;
+		if (name == "gamma")
+		{
+			effect = &gammaEffect;
+		}
+		else if (name == "fxaa")
+		{
+			effect = &fxaaEffect;
+		}
+		else if (name == "blur")
+		{
+			effect = &blurEffect;
+		}
+		else if (name == "downsample")
+		{
+			effect = &downsampleEffect;
+		}
+		postProcessChain.add(effect);
+	}
+	const glm::ivec2 outputSize = postProcessChain.getOutputSize(glm::ivec2(options.width, options.height));
+
+	// With --shm the last stage writes straight into shared memory: the post chain if there is one, else the renderer.
+	SharedFrameBuffer* sharedFrame = nullptr;
+	if (options.sharedMemoryName.empty() == false)
+	{
+		sharedFrame = SharedFrameBuffer::create(options.sharedMemoryName, outputSize.x, outputSize.y);
+		if (sharedFrame == nullptr)
+		{
+			return 1;
+		}
+	}
+	FrameBuffer* frameBuffer = nullptr;
+	if (sharedFrame == nullptr || postProcessChain.isEmpty() == false)
+	{
+		frameBuffer = new FrameBuffer(options.width, options.height);
+	}
+	Renderer renderer(frameBuffer ? *frameBuffer : sharedFrame->getFrameBuffer());
+	FrameBuffer* postBuffer = nullptr;
+	if (postProcessChain.isEmpty() == false && sharedFrame == nullptr)
+	{
+		postBuffer = new FrameBuffer(outputSize.x, outputSize.y);
+	}
+	FrameBuffer* postTarget = sharedFrame ? &sharedFrame->getFrameBuffer() : postBuffer;
+
+	FrameSink* frameSink = nullptr;
+	if (options.output.empty() == false)
+	{
+		if (options.output != "/dev/null")
+		{
+			std::filesystem::create_directories(options.output);
+		}
+		frameSink = new FrameSink(outputSize.x, outputSize.y, renderer.getFrameBuffer()->getOrigin());
+	}
+
+	DebugBuffers* debugBuffers = nullptr;
+	if (options.debugBuffersPath.empty() == false)
+	{
+		std::filesystem::create_directories(options.debugBuffersPath);
+		debugBuffers = new DebugBuffers(options.width, options.height);
+		renderer.setDebugBuffers(debugBuffers);
+	}
+
+	FCamera camera = FCamera(options.width, options.height);
+	camera.MoveBack(1.0);
+	const glm::mat4x4 viewMat = camera.GetViewMat();
+	const glm::mat4x4 projectionMat = camera.GetprojectionMat();
+	const Frustum frustum = camera.GetFrustum();
+
+	// Copies are laid out on a square grid in front of the camera, most of them off screen for large counts.
+	Scene scene;
+	std::vector<glm::vec3> offsets;
+	const int gridSize = (int)std::ceil(std::sqrt((double)options.copies));
+	const float spacing = 2.5f;
+	for (int i = 0; i < options.copies; i++)
+	{
+		const glm::vec2 cell = glm::vec2(i % gridSize, i / gridSize) - glm::vec2((gridSize - 1) * 0.5f);
+		offsets.push_back(glm::vec3(cell * spacing, 5.0f));
+		scene.addNode(&mesh, glm::mat4x4(1.0));
+	}
+
+	OcclusionBuffer* occlusionBuffer = nullptr;
+	if (options.isOcclusionEnabled && mesh.getBounds().isValid())
+	{
+		// The scene mesh stretched into a thin wall between the camera and the lower half of the grid.
+		const float gridExtent = gridSize * spacing * 0.5f;
+		const glm::vec3 wallExtent = glm::vec3(gridExtent, gridExtent * 0.5f, 0.05f);
+		const glm::vec3 wallCenter = glm::vec3(0.0f, -gridExtent * 0.5f, 3.0f);
+		// Flat meshes, e.g. a quad, have a zero extent on one axis; clamped so the scale stays finite.
+		const glm::vec3 meshExtent = glm::max(mesh.getBounds().extent(), glm::vec3(1e-4f));
+		const glm::mat4x4 wallMat = glm::translate(glm::mat4x4(1.0), wallCenter)
+			* glm::scale(glm::mat4x4(1.0), wallExtent / meshExtent)
+			* glm::translate(glm::mat4x4(1.0), -mesh.getBounds().center());
+		const int wall = scene.addNode(&mesh, wallMat);
+		scene.setOccluder(wall, true);
+		occlusionBuffer = new OcclusionBuffer();
+	}
+
+	ModelShader colorShader;
+	colorShader.viewMat = viewMat;
+	colorShader.projectionMat = projectionMat;
+	ModelShader2 textureShader;
+	textureShader.viewMat = viewMat;
+	textureShader.projectionMat = projectionMat;
+	textureShader.texture = texture;
+
+	std::vector<double> renderTimes;
+	const auto totalStart = std::chrono::steady_clock::now();
+
+	for (int frameIndex = 0; frameIndex < options.frameCount; frameIndex++)
+	{
+		const float time = (float)(options.startTime + frameIndex * options.timeStep);
+
+		const auto renderStart = std::chrono::steady_clock::now();
+		renderer.resetStatistics();
+		renderer.flush();
+
+		const glm::mat4x4 scaleMat = glm::scale(glm::mat4x4(1.0), glm::vec3(1.0f, 1.0f, 1.0f));
+		const glm::mat4x4 rotateMat = glm::rotate(glm::mat4x4(1.0), glm::radians(time * 5.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+		for (int i = 0; i < options.copies; i++)
+		{
+			const glm::mat4x4 translateMat = glm::translate(glm::mat4x4(1.0), offsets[i]);
+			scene.setLocalTransform(i, translateMat * rotateMat * scaleMat);
+		}
+		scene.update();
+		if (occlusionBuffer)
+		{
+			occlusionBuffer->begin(camera);
+			scene.renderOccluders(*occlusionBuffer, frustum);
+		}
+
+		Shader* shader = isTextured ? static_cast<Shader*>(&textureShader) : static_cast<Shader*>(&colorShader);
+		const int drawCount = scene.drawInstanced(renderer, frustum, shader, occlusionBuffer);
+		if (postProcessChain.isEmpty() == false)
+		{
+			postProcessChain.run(*renderer.getFrameBuffer(), *postTarget);
+		}
+		const auto renderEnd = std::chrono::steady_clock::now();
+
+		if (debugBuffers)
+		{
+			const std::filesystem::path folder(options.debugBuffersPath);
+			PPM::writeHeatmapToFile(*debugBuffers, DebugBufferType::overdraw, (folder / fmt::format("overdraw_{:05d}.ppm", frameIndex)).string());
+			PPM::writeHeatmapToFile(*debugBuffers, DebugBufferType::fragmentsShaded, (folder / fmt::format("fragments_{:05d}.ppm", frameIndex)).string());
+			PPM::writeHeatmapToFile(*debugBuffers, DebugBufferType::tileTriangles, (folder / fmt::format("tiles_{:05d}.ppm", frameIndex)).string());
+		}
+
+		if (frameSink)
+		{
+			// A shared frame is copied: swapping would move the slot out of the shared region.
+			if (sharedFrame)
+			{
+				frameSink->submit(sharedFrame->getFrameBuffer(), frameFilename(options, frameIndex), options.format);
+			}
+			else
+			{
+				frameSink->submitBySwap(postBuffer ? *postBuffer : *renderer.mutableFrameBuffer(), frameFilename(options, frameIndex), options.format);
+			}
+		}
+		if (sharedFrame)
+		{
+			sharedFrame->publish();
+		}
+		const auto submitEnd = std::chrono::steady_clock::now();
+
+		const double renderMs = std::chrono::duration<double, std::milli>(renderEnd - renderStart).count();
+		const double submitMs = std::chrono::duration<double, std::milli>(submitEnd - renderEnd).count();
+		renderTimes.push_back(renderMs);
+		spdlog::info("frame {} t={:.4f}s render {:.3f} ms, submit {:.3f} ms, drawn {}/{}", frameIndex, time, renderMs, submitMs, drawCount, scene.getNodeCount());
+#if defined(SR_ENABLE_PROFILING)
+		const PipelineStatistics& statistics = renderer.getStatistics();
+		spdlog::info("  vertices {} | triangles culled {} clipped {} rasterized {} | pixels tested {} clipped {} | depth pass {} fail {} (early {}) | stencil fail {} | fragments {} broadcast {} | overdraw {:.3f}",
+			statistics.verticesShaded, statistics.trianglesCulled, statistics.trianglesClipped, statistics.trianglesRasterized,
+			statistics.pixelsTested, statistics.fragmentsClipped, statistics.depthPasses, statistics.depthFails, statistics.earlyDepthFails, statistics.stencilFails, statistics.fragmentsShaded, statistics.fragmentsBroadcast,
+			statistics.overdraw(options.width * options.height));
+#endif
+	}
+
+	if (frameSink)
+	{
+		frameSink->wait();
+		delete frameSink;
+	}
+	const double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - totalStart).count();
+
+	std::vector<double> sortedTimes = renderTimes;
+	std::sort(sortedTimes.begin(), sortedTimes.end());
+	double sum = 0.0;
+	for (const double renderMs : renderTimes)
+	{
+		sum += renderMs;
+	}
+	spdlog::info("{} frames {}x{}: render avg {:.3f} ms, min {:.3f} ms, median {:.3f} ms, max {:.3f} ms, total {:.3f} ms",
+		options.frameCount, options.width, options.height,
+		sum / renderTimes.size(), sortedTimes.front(), sortedTimes[sortedTimes.size() / 2], sortedTimes.back(), totalMs);
+	const ArenaStatistics arenaStatistics = renderer.getFrameArenaStatistics();
+	spdlog::info("frame arena: high water {} KiB, reserved {} KiB, {} block allocations",
+		arenaStatistics.highWaterBytes / 1024, arenaStatistics.reservedBytes / 1024, arenaStatistics.blockAllocations);
+
+	if (options.tracePath.empty() == false)
+	{
+#if defined(SR_ENABLE_PROFILING)
+		Profiler::get().writeChromeTrace(options.tracePath);
+#else
+		spdlog::warn("--trace ignored, build with the profiling option enabled");
+#endif
+	}
+
+	renderer.setDebugBuffers(nullptr);
+	delete debugBuffers;
+	delete postBuffer;
+	delete frameBuffer;
+	delete sharedFrame;
+	delete occlusionBuffer;
+	delete sceneMesh;
+	delete meshFile;
+	delete texture;
+	return 0;
+}
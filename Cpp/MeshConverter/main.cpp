@@ -0,0 +1,90 @@
+#include <iostream>
+#include <string>
+
+#include "glm/glm.hpp"
+#include "assimp/Importer.hpp"
+#include "assimp/postprocess.h"
+#include "assimp/scene.h"
+#include "spdlog/spdlog.h"
+
+#include "Util.hpp"
+#include "ModelShader.hpp"
+#include "ModelShader2.hpp"
+#include "Mesh.hpp"
+#include "MeshFile.hpp"
+
+void printUsage()
+{
+	std::cout << "Usage: MeshConverter <input .dae/.fbx> <output .srmesh> [color|texture]" << std::endl;
+	std::cout << "  color    BaseVertex with the material diffuse color (default)" << std::endl;
+	std::cout << "  texture  BaseVertex2 with the first texture coordinate set" << std::endl;
+}
+
+int main(int argc, char ** argv)
+{
+	if (argc < 3 || argc > 4)
+	{
+		printUsage();
+		return 1;
+	}
+	const std::string inputPath = argv[1];
+	const std::string outputPath = argv[2];
+	const std::string format = argc == 4 ? argv[3] : "color";
+	if (format != "color" && format != "texture")
+	{
+		printUsage();
+		return 1;
+	}
+
+	Assimp::Importer importer;
+	const aiScene* scene = importer.ReadFile(inputPath, (aiProcess_Triangulate | aiProcess_JoinIdenticalVertices));
+	if (scene == nullptr)
+	{
+		spdlog::error("Can not load {}: {}", inputPath, importer.GetErrorString());
+		return 1;
+	}
+
+	Mesh* mesh = nullptr;
+	MeshVertexFormat vertexFormat = MeshVertexFormat::baseVertex;
+	if (format == "texture")
+	{
+		for (unsigned int i = 0; i < scene->mNumMeshes; i++)
+		{
+			if (scene->mMeshes[i]->HasTextureCoords(0) == false)
+			{
+				spdlog::error("{}: mesh {} has no texture coordinates", inputPath, i);
+				return 1;
+			}
+		}
+		vertexFormat = MeshVertexFormat::baseVertex2;
+		mesh = Mesh::fromScene<BaseVertex2>(scene, [](const aiMesh* mesh, const aiMaterial* material, unsigned int index) {
+			const aiVector3D vertex = mesh->mVertices[index];
+			const aiVector3D coords = mesh->mTextureCoords[0][index];
+			BaseVertex2 baseVertex;
+			baseVertex.position = glm::vec3(vertex.x, vertex.y, vertex.z);
+			baseVertex.textureCoords = glm::vec2(coords.x, coords.y);
+			return baseVertex;
+		});
+	}
+	else
+	{
+		mesh = Mesh::fromScene<BaseVertex>(scene, [](const aiMesh* mesh, const aiMaterial* material, unsigned int index) {
+			aiColor4D diffuseColor;
+			material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuseColor);
+			const aiVector3D vertex = mesh->mVertices[index];
+			BaseVertex baseVertex;
+			baseVertex.position = glm::vec3(vertex.x, vertex.y, vertex.z);
+			baseVertex.color = glm::vec3(diffuseColor.r, diffuseColor.g, diffuseColor.b);
+			return baseVertex;
+		});
+	}
+
+	const bool isWritten = MeshFile::write(outputPath, *mesh, vertexFormat, MeshMaterial::fromScene(scene));
+	if (isWritten)
+	{
+		spdlog::info("{} -> {}: {} vertices, {} triangles, {} sub meshes", inputPath, outputPath,
+			mesh->getVertexCount(), mesh->getTriangleCount(), mesh->getSubMeshes().size());
+	}
+	delete mesh;
+	return isWritten ? 0 : 1;
+}
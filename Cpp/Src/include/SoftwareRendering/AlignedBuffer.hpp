@@ -0,0 +1,34 @@
+#pragma once
+#include <stddef.h>
+
+/*
+Owning byte buffer aligned to a cache line.
+*/
+class AlignedBuffer
+{
+public:
+	static constexpr size_t alignment = 64;
+
+	AlignedBuffer();
+	explicit AlignedBuffer(const size_t size);
+	AlignedBuffer(AlignedBuffer&& other) noexcept;
+	AlignedBuffer(const AlignedBuffer&) = delete;
+	~AlignedBuffer();
+
+	AlignedBuffer& operator=(AlignedBuffer&& other) noexcept;
+	AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+private:
+	unsigned char* bytes = nullptr;
+	size_t length = 0;
+
+public:
+	size_t size() const;
+	const void* data() const;
+	void* mutableData();
+
+	/*
+	Reallocates to size bytes. Existing contents are discarded.
+	*/
+	void reset(const size_t size);
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+
+#include "BoundingBox.hpp"
+#include "Frustum.hpp"
+
+/*
+Bounding volume hierarchy over a list of boxes, split at the median of the longest centroid axis.
+Items are referred to by their index in the list passed to build.
+*/
+class BVH
+{
+public:
+	static constexpr int maxLeafSize = 4;
+
+private:
+	struct Node
+	{
+		BoundingBox bounds;
+		int left = -1;
+		int right = -1;
+		int first = 0;
+		int count = 0;
+
+		bool isLeaf() const;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<int> items;
+	std::vector<BoundingBox> itemBounds;
+
+public:
+	void build(const std::vector<BoundingBox>& boxes);
+
+	/*
+	Recomputes node bounds after the boxes moved without rebuilding the tree. boxes must have the size passed to build.
+	Cheaper than build, but the tree degrades if objects move far from where they were built.
+	*/
+	void refit(const std::vector<BoundingBox>& boxes);
+
+	/*
+	Appends the items whose box is not outside the frustum. Subtrees fully inside are taken without testing their items.
+	*/
+	void query(const Frustum& frustum, std::vector<int>& visibleItems) const;
+
+	int getItemCount() const;
+	int getNodeCount() const;
+
+private:
+	int buildNode(const std::vector<BoundingBox>& boxes, const int first, const int count);
+	void refitNode(const std::vector<BoundingBox>& boxes, const int nodeIndex);
+	void collect(const int nodeIndex, std::vector<int>& visibleItems) const;
+};
@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+#include <chrono>
+
+class Benchmark
+{
+public:
+	static Benchmark run();
+
+private:
+	std::chrono::steady_clock::time_point start;
+
+public:
+	double durationSec() const;
+	std::chrono::steady_clock::duration duration() const;
+	void print(const std::string& tag) const;
+};
@@ -0,0 +1,22 @@
+#pragma once
+#include <limits>
+
+#include <glm/glm.hpp>
+
+struct BoundingBox
+{
+	glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+
+	bool isValid() const noexcept;
+	glm::vec3 center() const noexcept;
+	glm::vec3 extent() const noexcept;
+
+	void expand(const glm::vec3& point) noexcept;
+	void expand(const BoundingBox& boundingBox) noexcept;
+
+	/*
+	Axis aligned box enclosing this box after transform.
+	*/
+	BoundingBox transform(const glm::mat4x4& matrix) const noexcept;
+};
@@ -3,6 +3,8 @@
 #include "glm/glm.hpp"
 #include "glm/ext/matrix_transform.hpp"
 
+#include "Frustum.hpp"
+
 class FCamera
 {
 public:
@@ -58,6 +60,7 @@ public:
 
 	glm::mat4 GetViewMat();
 	glm::mat4 GetprojectionMat();
+	Frustum GetFrustum();
 	glm::vec3 GetPosition();
 
 	virtual void ScrollCallback(double Xoffset, double Yoffset);
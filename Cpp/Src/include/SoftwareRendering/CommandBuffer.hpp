@@ -0,0 +1,64 @@
+#pragma once
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+#include "glm/glm.hpp"
+
+#include "RenderPipeLine.hpp"
+
+enum class RenderQueue
+{
+	opaque,
+	transparent
+};
+
+/*
+One recorded draw. depth is the view space distance used for ordering, see CommandBuffer::viewDepth.
+texture only groups packets that sample the same texture. bindUniforms, if set, runs right before the draw
+and is where per object shader state such as modelMat is applied.
+*/
+struct DrawPacket
+{
+	RenderPipeline pipeline;
+	RenderQueue queue = RenderQueue::opaque;
+	float depth = 0.0f;
+	const void* texture = nullptr;
+	std::function<void()> bindUniforms;
+};
+
+/*
+Records draws and replays them in a sorted order through Renderer::execute.
+Opaque packets come first, front to back in coarse depth buckets and grouped by shader and texture inside a bucket,
+so near geometry fills the depth buffer early and hidden fragments are rejected before shading.
+Transparent packets follow strictly back to front. Packets with equal keys keep their submission order.
+*/
+class CommandBuffer
+{
+private:
+	std::vector<DrawPacket> packets;
+	std::vector<uint64_t> keys;
+	std::vector<int> order;
+	std::unordered_map<const void*, int> shaderIds;
+	std::unordered_map<const void*, int> textureIds;
+	bool isSorted = true;
+
+public:
+	void submit(const DrawPacket& packet);
+	void clear();
+	void sort();
+
+	int getPacketCount() const;
+
+	/*
+	Packet at position index of the sorted order. sort must have been called after the last submit.
+	*/
+	const DrawPacket& getSortedPacket(const int index) const;
+
+	static float viewDepth(const glm::mat4x4& viewMat, const glm::vec3& worldPoint);
+
+private:
+	int idOf(std::unordered_map<const void*, int>& ids, const void* key);
+	uint64_t sortKey(const DrawPacket& packet);
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+
+#include "glm/glm.hpp"
+
+enum class DebugBufferType
+{
+	overdraw,
+	fragmentsShaded,
+	tileTriangles
+};
+
+/*
+Diagnostic counters filled by Renderer::pipeline when attached with Renderer::setDebugBuffers.
+overdraw counts depth tests per pixel, fragmentsShaded counts fragment shader invocations per pixel
+and tileTriangles counts the triangles covering at least one pixel of each tileSize x tileSize tile, whether or not
+their fragments pass the depth test.
+*/
+class DebugBuffers
+{
+public:
+	DebugBuffers(int width, int height);
+
+public:
+	static constexpr int tileSize = 8;
+
+private:
+	int width = 0;
+	int height = 0;
+	int tileCountX = 0;
+	int tileCountY = 0;
+	std::vector<unsigned int> overdraw;
+	std::vector<unsigned int> fragmentsShaded;
+	std::vector<unsigned int> tileTriangles;
+	std::vector<int> tileStamps;
+	int triangleStamp = 0;
+
+public:
+	int getWidth() const;
+	int getHeight() const;
+
+	void clear();
+	void beginTriangle();
+	void addDepthTest(const glm::ivec2 index);
+	void addFragmentShaded(const glm::ivec2 index);
+
+	/*
+	A pixel covered by the current triangle, counted before the stencil and depth tests.
+	*/
+	void addTriangleCoverage(const glm::ivec2 index);
+
+	/*
+	Value of the counter for the pixel at index; tile counters are returned for every pixel of the tile.
+	*/
+	unsigned int getValue(const DebugBufferType type, const glm::ivec2 index) const;
+	unsigned int getMaxValue(const DebugBufferType type) const;
+};
@@ -1,10 +1,12 @@
 #pragma once
-#include <functional>
 
+/*
+Depth tests of the immediate mode calls (setColor, addTriangle3D). RenderPipeline uses DepthStencilState instead.
+*/
 struct DepthFunc
 {
 
-	typedef std::function<bool(double, double)> closure;
+	typedef bool (*closure)(double, double);
 
 	static bool always(const double inputZ, const double z)
 	{
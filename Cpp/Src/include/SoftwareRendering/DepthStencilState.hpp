@@ -0,0 +1,87 @@
+#pragma once
+
+enum class CompareOp
+{
+	never,
+	less,
+	equal,
+	lequal,
+	greater,
+	notequal,
+	gequal,
+	always
+};
+
+enum class StencilOp
+{
+	keep,
+	zero,
+	replace,
+	incrementClamp,
+	decrementClamp,
+	invert,
+	incrementWrap,
+	decrementWrap
+};
+
+/*
+Per draw depth and stencil configuration of RenderPipeline.
+The stencil test runs before the depth test and both run before the fragment shader, so fragments outside a stencil mask
+are never shaded. Stencil ops are applied once per pixel and triangle.
+*/
+struct DepthStencilState
+{
+	CompareOp depthCompare = CompareOp::less;
+	bool isDepthWriteEnabled = true;
+
+	bool isStencilEnabled = false;
+	CompareOp stencilCompare = CompareOp::always;
+	unsigned char stencilReference = 0;
+	unsigned char stencilReadMask = 0xff;
+	unsigned char stencilWriteMask = 0xff;
+	StencilOp stencilFailOp = StencilOp::keep;
+	StencilOp depthFailOp = StencilOp::keep;
+	StencilOp passOp = StencilOp::keep;
+
+	/*
+	Writes reference into the stencil buffer wherever the draw passes, without touching depth or color tests.
+	*/
+	static DepthStencilState stencilMask(const unsigned char reference) noexcept;
+
+	/*
+	Draws only where the stencil buffer equals reference.
+	*/
+	static DepthStencilState stencilEqual(const unsigned char reference) noexcept;
+};
+
+template<CompareOp op, typename T>
+inline bool compare(const T value, const T reference) noexcept
+{
+	if constexpr (op == CompareOp::never) return false;
+	else if constexpr (op == CompareOp::less) return value < reference;
+	else if constexpr (op == CompareOp::equal) return value == reference;
+	else if constexpr (op == CompareOp::lequal) return value <= reference;
+	else if constexpr (op == CompareOp::greater) return value > reference;
+	else if constexpr (op == CompareOp::notequal) return value != reference;
+	else if constexpr (op == CompareOp::gequal) return value >= reference;
+	else return true;
+}
+
+template<typename T>
+inline bool compare(const CompareOp op, const T value, const T reference) noexcept
+{
+	switch (op)
+	{
+	case CompareOp::never: return compare<CompareOp::never>(value, reference);
+	case CompareOp::less: return compare<CompareOp::less>(value, reference);
+	case CompareOp::equal: return compare<CompareOp::equal>(value, reference);
+	case CompareOp::lequal: return compare<CompareOp::lequal>(value, reference);
+	case CompareOp::greater: return compare<CompareOp::greater>(value, reference);
+	case CompareOp::notequal: return compare<CompareOp::notequal>(value, reference);
+	case CompareOp::gequal: return compare<CompareOp::gequal>(value, reference);
+	case CompareOp::always: return compare<CompareOp::always>(value, reference);
+	}
+	return false;
+}
+
+unsigned char applyStencilOp(const StencilOp op, const unsigned char value, const unsigned char reference) noexcept;
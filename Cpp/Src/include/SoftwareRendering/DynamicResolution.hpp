@@ -0,0 +1,91 @@
+#pragma once
+#include <vector>
+
+#include "FrameBuffer.hpp"
+#include "Renderer.hpp"
+
+enum class UpscaleFilter
+{
+	bilinear,
+
+	/*
+	Bilinear with the weight of each tap reduced by its luma difference to the nearest tap, so edges stay sharp
+	instead of being smeared over the magnified pixels.
+	*/
+	edgeAware
+};
+
+/*
+Scales source to the size of target. Both may be views; their origins must match.
+*/
+void upscale(const FrameBuffer& source, FrameBuffer& target, const UpscaleFilter filter);
+
+/*
+Renders at a variable internal resolution to hold a frame time budget. The frame is drawn with getRenderer(), whose
+frame buffer is a view of the first rows and columns of full size storage, then resolve scales it to the output size.
+Every scale level has its own Renderer that is created on first use and kept, so changing the scale never reallocates
+pixel storage and a level keeps its scratch buffers when it is picked again.
+*/
+class DynamicResolution
+{
+public:
+	static constexpr int levelCount = 11;
+
+	DynamicResolution(int width, int height, const FrameBufferOrigin origin = FrameBufferOrigin::topLeft, const float minScale = 0.5f);
+	~DynamicResolution();
+	DynamicResolution(const DynamicResolution&) = delete;
+	DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+	float targetFrameMs = 33.0f;
+	UpscaleFilter filter = UpscaleFilter::bilinear;
+
+	/*
+	The scale only rises while frames take less than this fraction of the target, so it does not flip between two
+	levels around the budget.
+	*/
+	float raiseThreshold = 0.8f;
+
+	/*
+	Frames measured after a change before the next one.
+	*/
+	int settleFrames = 8;
+
+private:
+	FrameBuffer storage;
+	float minScale = 0.5f;
+	int level = levelCount - 1;
+	bool isLocked = false;
+	std::vector<FrameBuffer*> views;
+	std::vector<Renderer*> renderers;
+	double smoothedFrameMs = 0.0;
+	int measuredFrames = 0;
+
+public:
+	int getWidth() const;
+	int getHeight() const;
+	float getScale() const;
+
+	/*
+	Renderer of the current scale. Draw a frame with it, including its flush, then call resolve.
+	*/
+	Renderer& getRenderer();
+
+	/*
+	Writes the current frame into output, which must have the full size and the origin given to the constructor.
+	*/
+	void resolve(FrameBuffer& output) const;
+
+	/*
+	Feeds the measured duration of the last frame and picks the scale of the next one.
+	*/
+	void update(const double frameMs);
+
+	/*
+	Fixes the scale to the nearest level and stops update from changing it; a negative scale unlocks.
+	*/
+	void lockScale(const float scale);
+
+private:
+	float levelScale(const int level) const;
+	int nearestLevel(const float scale) const;
+};
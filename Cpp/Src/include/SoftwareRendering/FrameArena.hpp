@@ -0,0 +1,245 @@
+#pragma once
+#include <stddef.h>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "AlignedBuffer.hpp"
+
+struct ArenaStatistics
+{
+	/*
+	Bytes handed out and not yet freed, including alignment padding.
+	*/
+	size_t usedBytes = 0;
+	size_t highWaterBytes = 0;
+
+	/*
+	Bytes currently held in blocks.
+	*/
+	size_t reservedBytes = 0;
+
+	/*
+	Blocks taken from the heap since the arena was created; stops growing once frames fit into the reserved blocks.
+	*/
+	int blockAllocations = 0;
+};
+
+/*
+Bump allocator for data that lives until the end of a frame. allocate moves a pointer forward, deallocate does nothing
+and reset frees everything at once; popMarker frees everything allocated since the matching pushMarker. Freed blocks
+are kept for reuse up to retainLimit bytes. An arena is used by one thread at a time.
+*/
+class LinearArena
+{
+public:
+	static constexpr int maxMarkerCount = 4;
+
+	explicit LinearArena(const size_t blockSize = 256 * 1024, const size_t retainLimit = 16 * 1024 * 1024);
+	LinearArena(const LinearArena&) = delete;
+	LinearArena& operator=(const LinearArena&) = delete;
+
+	/*
+	Binds an arena to the calling thread for the lifetime of the scope; containers using a default ArenaAllocator
+	allocate from it. The previous binding is restored on exit, so scopes nest.
+	*/
+	class Scope
+	{
+	public:
+		explicit Scope(LinearArena& arena);
+		~Scope();
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		LinearArena* previous = nullptr;
+	};
+
+private:
+	struct Marker
+	{
+		size_t block = 0;
+		size_t offset = 0;
+		size_t usedBytes = 0;
+	};
+
+	std::vector<AlignedBuffer> blocks;
+	size_t blockSize = 0;
+	size_t retainLimit = 0;
+	size_t currentBlock = 0;
+	size_t offset = 0;
+	size_t framePeakBytes = 0;
+	ArenaStatistics statistics;
+	Marker markers[maxMarkerCount];
+	int markerCount = 0;
+
+public:
+	/*
+	alignment must not exceed AlignedBuffer::alignment.
+	*/
+	void* allocate(const size_t size, const size_t alignment);
+
+	/*
+	Remembers the current position; the matching popMarker frees everything allocated after it. Blocks opened
+	meanwhile stay reserved and are reused by later allocations.
+	*/
+	void pushMarker();
+
+	/*
+	Rewinds to the last pushed marker, or to the start when none is pushed, which is the case for an arena created
+	after the marker was pushed on the others.
+	*/
+	void popMarker();
+
+	/*
+	Frees every allocation. If the frame needed more than one block they are merged into one block of the frame's
+	peak use, capped at retainLimit, so the next frame usually allocates from a single block without touching the heap.
+	*/
+	void reset();
+
+	const ArenaStatistics& getStatistics() const;
+
+	/*
+	Arena bound to the calling thread by a Scope, or nullptr.
+	*/
+	static LinearArena* current();
+};
+
+/*
+Standard allocator over a LinearArena. Default constructed allocators use the arena bound to the calling thread and fall
+back to the heap when there is none, so types like RasterizationData also work outside of the renderer.
+Moves carry the arena along; copies allocate from the arena of the copying thread.
+*/
+template<typename T>
+class ArenaAllocator
+{
+public:
+	using value_type = T;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	ArenaAllocator() noexcept
+		:arena(LinearArena::current())
+	{
+
+	}
+
+	explicit ArenaAllocator(LinearArena* arena) noexcept
+		:arena(arena)
+	{
+
+	}
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+		:arena(other.getArena())
+	{
+
+	}
+
+	T* allocate(const size_t count)
+	{
+		if (arena)
+		{
+			return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+		}
+		return static_cast<T*>(::operator new(count * sizeof(T)));
+	}
+
+	void deallocate(T* pointer, const size_t count) noexcept
+	{
+		if (arena == nullptr)
+		{
+			::operator delete(pointer);
+		}
+	}
+
+	ArenaAllocator select_on_container_copy_construction() const noexcept
+	{
+		return ArenaAllocator();
+	}
+
+	LinearArena* getArena() const noexcept
+	{
+		return arena;
+	}
+
+private:
+	LinearArena* arena = nullptr;
+};
+
+template<typename T, typename U>
+inline bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) noexcept
+{
+	return lhs.getArena() == rhs.getArena();
+}
+
+template<typename T, typename U>
+inline bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) noexcept
+{
+	return lhs.getArena() != rhs.getArena();
+}
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+/*
+Transient memory of one frame: a LinearArena per JobSystem worker and one per other thread that used it, so the jobs of
+a draw allocate without sharing an arena. Threads JobSystem does not own include the renderer's caller and callers of
+other renderers that run this renderer's jobs while they wait. Everything allocated from it is valid until reset.
+*/
+class FrameArena
+{
+public:
+	FrameArena();
+	~FrameArena();
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	/*
+	Frees everything allocated from the frame arena while the scope lives, on every thread, when it ends; for data of
+	a single draw or instance. Scopes nest up to LinearArena::maxMarkerCount deep. Jobs that allocate from the arenas
+	must have finished when the scope ends.
+	*/
+	class TransientScope
+	{
+	public:
+		explicit TransientScope(FrameArena& frameArena);
+		~TransientScope();
+		TransientScope(const TransientScope&) = delete;
+		TransientScope& operator=(const TransientScope&) = delete;
+
+	private:
+		FrameArena& frameArena;
+	};
+
+private:
+	std::vector<LinearArena*> arenas;
+
+	/*
+	Arenas of threads JobSystem does not own, created on first use. A thread that exits leaves its arena to the next
+	thread with the same id.
+	*/
+	mutable std::mutex foreignMutex;
+	std::vector<std::pair<std::thread::id, LinearArena*>> foreignArenas;
+
+public:
+	LinearArena& forCurrentThread();
+
+	/*
+	Must not be called while jobs still use the arenas.
+	*/
+	void reset();
+
+	/*
+	Sum over all threads. highWaterBytes adds the high water mark of every thread.
+	*/
+	ArenaStatistics getStatistics() const;
+
+private:
+	template<typename Function>
+	void forEachArena(const Function& function) const;
+};
@@ -1,49 +1,138 @@
 #pragma once
 #include <array>
-#include <functional>
+#include <stddef.h>
+#include <stdint.h>
 
 #include "glm/glm.hpp"
 
+#include "Rect.hpp"
+#include "DepthFunc.hpp"
+#include "TileMask.hpp"
+
 enum class BufferType
 {
 	data,
 	z
 };
 
+/*
+Row order of the pixel data. topLeft matches image files (PPM, QOI, PNG), bottomLeft matches glDrawPixels.
+The encoders walk the rows from getTopRow, so both come out upright.
+The values are stored in SharedFrameHeader, so they must not change.
+*/
+enum class FrameBufferOrigin : uint32_t
+{
+	topLeft = 0,
+	bottomLeft = 1
+};
+
 class FrameBuffer
 {
 public:
-	FrameBuffer(int width, int height);
+	FrameBuffer(int width, int height, const FrameBufferOrigin origin = FrameBufferOrigin::topLeft);
+
+	/*
+	Keeps the color rows in colorData, width * height * 3 bytes the caller owns, e.g. shared memory; depth and stencil
+	are owned as usual.
+	*/
+	FrameBuffer(int width, int height, unsigned char* colorData, const FrameBufferOrigin origin = FrameBufferOrigin::topLeft);
+
+	/*
+	View of rect inside parent, e.g. one cell of an atlas. It shares the parent's pixels and depth, maps NDC to the
+	rectangle only and must not outlive the parent.
+	*/
+	FrameBuffer(FrameBuffer& parent, const PixelRect& rect);
 	~FrameBuffer();
 
 public:
 	int getWidth() const;
 	int getHeight() const;
+	FrameBufferOrigin getOrigin() const;
+
+	/*
+	Distance between two rows in pixels: the width for an owning buffer, the parent's pitch for a view.
+	*/
+	int getPitch() const;
+	bool isView() const;
+
+	/*
+	False for views and for buffers made with caller owned color storage.
+	*/
+	bool ownsAllData() const;
+
+	/*
+	Color of the top row of the image and the distance in bytes to the row below it, negative for bottomLeft buffers.
+	*/
+	const unsigned char* getTopRow() const;
+	ptrdiff_t getRowStep() const;
+
+	/*
+	flush and clear split the buffer into JobSystem jobs of this many rows.
+	*/
+	static constexpr int clearRowsPerJob = 64;
 
 private:
 	int width = 0;
 	int height = 0;
+	int pitch = 0;
+	FrameBufferOrigin origin = FrameBufferOrigin::topLeft;
+	bool isOwner = true;
+	bool ownsColor = true;
 	unsigned char* data = nullptr;
 	double* zBuffer = nullptr;
+	unsigned char* stencilBuffer = nullptr;
 
 public:
 	glm::ivec2 ndcPointToPixelIndex(const glm::vec2 point) const;
 	int pixelIndexToBufferIndex(const glm::ivec2 index) const;
 	int ndcPointToBufferIndex(const glm::vec2 point) const;
 
+	/*
+	NDC area whose points map into rect.
+	*/
+	Rect pixelRectToNdc(const PixelRect& rect) const;
+
+	/*
+	Pixels that points of ndc map to, clamped to the buffer; empty when ndc lies outside.
+	*/
+	PixelRect ndcRectToPixels(const Rect& ndc) const;
+
 	glm::vec3 getPixel(const glm::vec2 point) const;
 	void setPixel(const glm::vec2 point, const glm::vec3 color);
 
-	void setPixel(const glm::vec3 point, const glm::vec3 color, const std::function<bool(double, double)> depthFunc);
+	void setPixel(const glm::vec3 point, const glm::vec3 color, const DepthFunc::closure depthFunc);
+	void setPixel(const int bufferIndex, const glm::vec3 color);
 
 	double zValueAtNdcPoint(const glm::vec3 point) const;
 
+	/*
+	Resets color to black, depth to 1 and stencil to 0.
+	*/
 	void flush();
+
+	/*
+	Resets the pixels of the set tiles to color, depth 1 and stencil 0 and keeps all others. tiles must match the size.
+	*/
+	void flush(const TileMask& tiles, const glm::vec3 color);
 	void clear(const glm::vec3 color);
+	void clearStencil(const unsigned char value);
 
+	/*
+	First pixel of the buffer; rows are getPitch() pixels apart.
+	*/
 	double const * const getZBuffer() const;
 	unsigned char const * const getData() const;
+	unsigned char const * const getStencilBuffer() const;
 
 	double* mutableZBuffer();
+	unsigned char* mutableStencilBuffer();
 	unsigned char* mutableData();
+
+	/*
+	Moves the color of a buffer made with caller owned color storage to other storage of the same size.
+	*/
+	void setColorData(unsigned char* colorData);
+
+	void swap(FrameBuffer& other);
+	void copyDataFrom(const FrameBuffer& other);
 };
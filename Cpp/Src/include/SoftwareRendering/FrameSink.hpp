@@ -0,0 +1,58 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+
+#include "FrameBuffer.hpp"
+#include "JobSystem.hpp"
+
+enum class ImageFormat
+{
+	ppm,
+	qoi,
+	png
+};
+
+/*
+Writes finished frames as jobs on the JobSystem.
+Frames are copied (or swapped) into a bounded ring of FrameBuffer slots; submit runs pending jobs while every slot is still being encoded.
+*/
+class FrameSink
+{
+public:
+	/*
+	Slots are made with origin, the row order of the frames that will be submitted.
+	*/
+	FrameSink(int width, int height, const FrameBufferOrigin origin = FrameBufferOrigin::topLeft, int capacity = 3);
+	~FrameSink();
+
+private:
+	struct Slot
+	{
+		FrameBuffer* frameBuffer = nullptr;
+		std::string filename;
+		ImageFormat format = ImageFormat::ppm;
+	};
+
+	std::vector<Slot> slots;
+	std::vector<int> freeSlots;
+	std::mutex mutex;
+	JobCounter pendingFrames;
+
+public:
+	void submit(const FrameBuffer& frameBuffer, const std::string& filename, const ImageFormat format);
+
+	/*
+	Trades frameBuffer for a free slot instead of copying it. frameBuffer must own all its data and match the size and
+	origin of the slots; it comes back holding the previous contents of the slot.
+	*/
+	void submitBySwap(FrameBuffer& frameBuffer, const std::string& filename, const ImageFormat format);
+	void wait();
+
+	int getCapacity() const;
+
+private:
+	int acquireSlot();
+	void enqueue(const int index);
+	void encode(const Slot& slot) const;
+};
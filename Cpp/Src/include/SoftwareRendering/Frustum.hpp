@@ -0,0 +1,46 @@
+#pragma once
+#include "glm/glm.hpp"
+
+#include "BoundingBox.hpp"
+
+struct Plane
+{
+	glm::vec3 normal = glm::vec3(0.0f, 0.0f, 1.0f);
+	float distance = 0.0f;
+
+	float signedDistance(const glm::vec3& point) const noexcept;
+};
+
+enum class FrustumTest
+{
+	outside,
+	intersect,
+	inside
+};
+
+/*
+Six planes with normals pointing into the view volume, extracted from a view projection matrix.
+*/
+class Frustum
+{
+public:
+	enum PlaneIndex
+	{
+		leftPlane,
+		rightPlane,
+		bottomPlane,
+		topPlane,
+		nearPlane,
+		farPlane
+	};
+
+	Plane planes[6];
+
+	/*
+	Expects clip space depth in [-w, w], which is what glm::perspective produces without GLM_FORCE_DEPTH_ZERO_TO_ONE.
+	*/
+	static Frustum fromMatrix(const glm::mat4x4& viewProjectionMat);
+
+	FrustumTest test(const BoundingBox& boundingBox) const noexcept;
+	bool isVisible(const BoundingBox& boundingBox) const noexcept;
+};
@@ -0,0 +1,149 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobCounter;
+
+struct Job
+{
+	std::function<void()> function;
+	JobCounter* counter = nullptr;
+};
+
+/*
+Counts the unfinished jobs submitted with it. Jobs submitted with JobSystem::submitAfter are held back until it reaches zero.
+A counter must outlive its jobs; JobSystem::wait on it before it goes out of scope.
+*/
+class JobCounter
+{
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+private:
+	friend class JobSystem;
+
+	std::atomic<int> count{ 0 };
+	std::mutex mutex;
+	std::vector<Job> continuations;
+
+public:
+	bool isDone() const;
+};
+
+/*
+Work-stealing scheduler shared by every stage that runs in parallel, so the process never runs more threads than cores.
+Each worker owns a deque: it pops its own newest job and steals the oldest job of another worker when empty.
+The thread that creates the system is worker 0; it has no dedicated thread and executes jobs only while it waits,
+which keeps the main thread free for work that must stay there (windowing, GL) and fully used otherwise.
+Waiting never blocks a thread that could run jobs, so jobs may submit and wait on nested jobs. A waiter with nothing
+to run, e.g. while the last job it needs runs on another thread, sleeps after a short spin instead of taking a core.
+*/
+class JobSystem
+{
+public:
+	/*
+	workerCount includes the creating thread, 0 uses every hardware thread. isPinned binds worker i to core i.
+	*/
+	explicit JobSystem(int workerCount = 0, const bool isPinned = false);
+	~JobSystem();
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	/*
+	Process wide instance, created by the first call with the values given to setup.
+	*/
+	static JobSystem& get();
+
+	/*
+	Must be called before the first get, typically from main.
+	*/
+	static void setup(const int workerCount, const bool isPinned);
+
+private:
+	/*
+	Double ended queue on a ring that only grows, so pushing and popping jobs stops allocating once it is warm.
+	*/
+	class JobQueue
+	{
+	public:
+		bool isEmpty() const;
+		void pushBack(Job&& job);
+		Job popBack();
+		Job popFront();
+
+	private:
+		std::vector<Job> slots;
+		size_t head = 0;
+		size_t count = 0;
+	};
+
+	struct Worker
+	{
+		std::mutex mutex;
+		JobQueue jobs;
+	};
+
+	std::vector<Worker*> workers;
+	std::vector<std::thread> threads;
+	std::atomic<int> pendingJobCount{ 0 };
+	std::atomic<unsigned int> nextQueue{ 0 };
+	std::mutex sleepMutex;
+	std::condition_variable sleepCondition;
+	bool isStopping = false;
+
+	/*
+	Threads sleeping in waitUntil; woken whenever a job is pushed or finishes.
+	*/
+	std::condition_variable waitCondition;
+	std::atomic<int> waitingCount{ 0 };
+
+public:
+	void submit(const std::function<void()>& function, JobCounter* counter = nullptr);
+
+	/*
+	Submits function once dependency reaches zero.
+	*/
+	void submitAfter(JobCounter& dependency, const std::function<void()>& function, JobCounter* counter = nullptr);
+
+	/*
+	Runs body over [0, count) in chunks of at most grainSize and returns when all chunks are done.
+	*/
+	void parallelFor(const int count, const int grainSize, const std::function<void(int, int)>& body);
+
+	/*
+	Executes other jobs until counter reaches zero.
+	*/
+	void wait(JobCounter& counter);
+
+	/*
+	Executes other jobs until isDone returns true, sleeping while there is nothing to run. isDone is checked again
+	whenever a job finishes, so it must only depend on state that jobs change.
+	*/
+	void waitUntil(const std::function<bool()>& isDone);
+
+	/*
+	Executes one pending job if there is any.
+	*/
+	bool runPendingJob();
+
+	int getWorkerCount() const;
+
+	/*
+	Index of the calling thread in [0, getWorkerCount()), or -1 for threads the system does not own.
+	*/
+	int currentWorkerIndex() const;
+
+private:
+	void push(Job job);
+	bool pop(Job& job);
+	void execute(Job& job);
+	void notifyWaiters();
+	void workerLoop(const int workerIndex);
+	static void pinCurrentThread(const int core);
+};
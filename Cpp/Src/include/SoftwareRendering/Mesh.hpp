@@ -0,0 +1,115 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include <assert.h>
+
+#include "glm/glm.hpp"
+#include "assimp/scene.h"
+
+#include "AlignedBuffer.hpp"
+#include "BoundingBox.hpp"
+
+struct SubMesh
+{
+	int firstIndex = 0;
+	int indexCount = 0;
+	int materialIndex = 0;
+};
+
+/*
+Vertex and index buffers converted once at load time and drawn every frame without rebuilding.
+Vertices are stored interleaved with the layout of the shader vertex struct (BaseVertex, BaseVertex2, ...).
+Drawing only reads the buffers, so one mesh can be shared by renderers on different threads.
+*/
+class Mesh
+{
+public:
+	Mesh(const int vertexStride, const int vertexCount, const int indexCount);
+
+	/*
+	Non-owning view over buffers that live elsewhere, e.g. the mapped pages of a MeshFile.
+	*/
+	Mesh(const void* vertexBuffer, const unsigned int* indexBuffer, const int vertexStride, const int vertexCount, const int indexCount);
+
+private:
+	AlignedBuffer vertices;
+	AlignedBuffer indices;
+	const void* vertexBuffer = nullptr;
+	const unsigned int* indexBuffer = nullptr;
+	int vertexStride = 0;
+	int vertexCount = 0;
+	int indexCount = 0;
+	BoundingBox bounds;
+	std::vector<SubMesh> subMeshes;
+
+public:
+	int getVertexStride() const;
+	int getVertexCount() const;
+	int getIndexCount() const;
+	int getTriangleCount() const;
+
+	const void* getVertexBuffer() const;
+	const unsigned int* getIndexBuffer() const;
+	void* mutableVertexBuffer();
+	unsigned int* mutableIndexBuffer();
+
+	const BoundingBox& getBounds() const;
+	void setBounds(const BoundingBox& bounds);
+
+	const std::vector<SubMesh>& getSubMeshes() const;
+	void setSubMeshes(const std::vector<SubMesh>& subMeshes);
+
+	/*
+	Merges every triangulated mesh of the scene into one Mesh. getVertex converts one vertex of an aiMesh.
+	*/
+	template<typename Vertex>
+	static Mesh* fromScene(const aiScene* scene, const std::function<Vertex(const aiMesh*, const aiMaterial*, unsigned int)>& getVertex);
+};
+
+template<typename Vertex>
+Mesh* Mesh::fromScene(const aiScene* scene, const std::function<Vertex(const aiMesh*, const aiMaterial*, unsigned int)>& getVertex)
+{
+	assert(scene);
+	int vertexCount = 0;
+	int indexCount = 0;
+	for (unsigned int meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++)
+	{
+		vertexCount += scene->mMeshes[meshIndex]->mNumVertices;
+		indexCount += scene->mMeshes[meshIndex]->mNumFaces * 3;
+	}
+
+	Mesh* mesh = new Mesh(sizeof(Vertex), vertexCount, indexCount);
+	Vertex* vertices = static_cast<Vertex*>(mesh->mutableVertexBuffer());
+	unsigned int* indices = mesh->mutableIndexBuffer();
+	BoundingBox bounds;
+	std::vector<SubMesh> subMeshes;
+	unsigned int baseVertex = 0;
+	for (unsigned int meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++)
+	{
+		const aiMesh* sceneMesh = scene->mMeshes[meshIndex];
+		const aiMaterial* material = scene->mMaterials[sceneMesh->mMaterialIndex];
+		for (unsigned int i = 0; i < sceneMesh->mNumVertices; i++)
+		{
+			vertices[baseVertex + i] = getVertex(sceneMesh, material, i);
+			const aiVector3D position = sceneMesh->mVertices[i];
+			bounds.expand(glm::vec3(position.x, position.y, position.z));
+		}
+		SubMesh subMesh;
+		subMesh.firstIndex = (int)(indices - mesh->mutableIndexBuffer());
+		subMesh.indexCount = sceneMesh->mNumFaces * 3;
+		subMesh.materialIndex = sceneMesh->mMaterialIndex;
+		subMeshes.push_back(subMesh);
+		for (unsigned int faceIndex = 0; faceIndex < sceneMesh->mNumFaces; faceIndex++)
+		{
+			const aiFace& face = sceneMesh->mFaces[faceIndex];
+			assert(face.mNumIndices == 3);
+			*indices++ = baseVertex + face.mIndices[0];
+			*indices++ = baseVertex + face.mIndices[1];
+			*indices++ = baseVertex + face.mIndices[2];
+		}
+		baseVertex += sceneMesh->mNumVertices;
+	}
+	mesh->setBounds(bounds);
+	mesh->setSubMeshes(subMeshes);
+	return mesh;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "glm/glm.hpp"
+#include "assimp/scene.h"
+
+#include "Mesh.hpp"
+
+/*
+Identifies which shader vertex struct the interleaved vertex data of a mesh file was written with.
+*/
+enum class MeshVertexFormat : uint32_t
+{
+	custom = 0,
+	baseVertex = 1,
+	baseVertex2 = 2
+};
+
+struct MeshMaterial
+{
+	glm::vec4 diffuseColor = glm::vec4(1.0f);
+	std::string diffuseTexture;
+
+	static std::vector<MeshMaterial> fromScene(const aiScene* scene);
+};
+
+/*
+Compact, versioned binary mesh file.
+MeshFile::write stores the vertex and index buffers of a Mesh byte for byte, together with bounds, sub meshes and materials.
+MeshFile::open maps the file into memory and the Mesh it returns points straight into the mapped pages, so nothing is parsed
+or copied at load time. Files are little-endian and not meant to be shared between machines of different byte order.
+*/
+class MeshFile
+{
+public:
+	static constexpr uint32_t version = 1;
+
+	~MeshFile();
+	MeshFile(const MeshFile&) = delete;
+	MeshFile& operator=(const MeshFile&) = delete;
+
+	static bool write(const std::string& filename, const Mesh& mesh, const MeshVertexFormat vertexFormat, const std::vector<MeshMaterial>& materials);
+
+	/*
+	Returns nullptr if the file can not be mapped or is not a valid mesh file of this version.
+	*/
+	static MeshFile* open(const std::string& filename);
+
+private:
+	MeshFile();
+
+	void* mappedData = nullptr;
+	size_t mappedSize = 0;
+#if defined(_WIN32)
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+	Mesh* mesh = nullptr;
+	MeshVertexFormat vertexFormat = MeshVertexFormat::custom;
+	std::vector<MeshMaterial> materials;
+
+public:
+	const Mesh& getMesh() const;
+	MeshVertexFormat getVertexFormat() const;
+	const std::vector<MeshMaterial>& getMaterials() const;
+};
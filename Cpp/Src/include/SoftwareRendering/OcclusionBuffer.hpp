@@ -0,0 +1,83 @@
+#pragma once
+#include <vector>
+#include <utility>
+
+#include "glm/glm.hpp"
+
+#include "FrameBuffer.hpp"
+#include "BoundingBox.hpp"
+#include "Camera.hpp"
+#include "Mesh.hpp"
+
+/*
+Low resolution depth of designated occluders, used to drop objects hidden behind them before vertex shading.
+Occluders are rasterized depth only into the z buffer of a small FrameBuffer with the same NDC mapping as the renderer;
+candidates are tested with the screen space rectangle and nearest depth of their bounding box.
+An occluder only writes pixels its triangles cover completely, with its farthest depth over the pixel, so culling
+never drops visible geometry. Pixels split between triangles of one occluder count as covered when the triangles
+leave no gap in them.
+*/
+class OcclusionBuffer
+{
+public:
+	OcclusionBuffer(int width = 256, int height = 128);
+	~OcclusionBuffer();
+	OcclusionBuffer(const OcclusionBuffer&) = delete;
+	OcclusionBuffer& operator=(const OcclusionBuffer&) = delete;
+
+private:
+	/*
+	Occluder triangle in pixel coordinates, counter-clockwise, with the NDC depth of its corners.
+	*/
+	struct ScreenTriangle
+	{
+		glm::vec2 points[3];
+		glm::vec3 depths;
+	};
+
+	FrameBuffer* frameBuffer = nullptr;
+	glm::mat4x4 viewProjectionMat = glm::mat4x4(1.0f);
+	int occluderTriangleCount = 0;
+
+	/*
+	Triangles of the occluder being added, and the pixels they cover only in part as (pixel, triangle) pairs.
+	*/
+	std::vector<ScreenTriangle> triangles;
+	std::vector<std::pair<int, int>> partialPixels;
+
+public:
+	/*
+	Clears the depth and starts a new frame seen through viewProjectionMat.
+	*/
+	void begin(const glm::mat4x4& viewProjectionMat);
+	void begin(FCamera& camera);
+
+	/*
+	Rasterizes the triangles of mesh. Vertices must start with a glm::vec3 position, as BaseVertex and BaseVertex2 do.
+	*/
+	void addOccluder(const Mesh& mesh, const glm::mat4x4& modelMat);
+
+	/*
+	False only if every pixel covered by the box lies behind occluder depth.
+	*/
+	bool isVisible(const BoundingBox& worldBounds) const;
+
+	const FrameBuffer* getFrameBuffer() const;
+	int getOccluderTriangleCount() const;
+
+private:
+	void rasterizeTriangle(const glm::vec3 a, const glm::vec3 b, const glm::vec3 c);
+
+	/*
+	Writes the pixels the triangles of the occluder cover together but none covers alone, e.g. along shared edges.
+	*/
+	void resolvePartialPixels();
+
+	/*
+	Nearest and farthest depth of the triangle's plane over pixel (x, y).
+	*/
+	void depthRange(const ScreenTriangle& triangle, const int x, const int y, float& nearZ, float& farZ) const;
+	void writeDepth(const int x, const int y, const float nearZ, const float farZ);
+	glm::vec2 ndcToPixel(const glm::vec2 point) const;
+	int bufferIndex(const int x, const int y) const;
+};
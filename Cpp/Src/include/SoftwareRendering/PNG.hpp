@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "FrameBuffer.hpp"
+
+/*
+RGB8 PNG encoder.
+Rows are split into bands that are filtered and deflated as JobSystem jobs. Every band but the last ends with a sync flush,
+so the raw deflate streams can be concatenated into one zlib stream; the adler32 checksums are combined afterwards.
+encodePixels returns an empty vector if zlib fails, and nothing is written then.
+*/
+class PNG
+{
+public:
+	static std::vector<unsigned char> encodePixels(const FrameBuffer& buffer, const int compressionLevel = 1, int bandCount = 0);
+	static void writePxielsToFile(const FrameBuffer& buffer, std::string filename);
+};
@@ -1,11 +1,19 @@
 #pragma once
 #include <string>
+#include <vector>
 
 #include "FrameBuffer.hpp"
+#include "DebugBuffers.hpp"
 
 class PPM
 {
 public:
 	static void writePxielsToFile(const FrameBuffer& buffer, std::string filename);
 	static void writeZBufferToFile(const FrameBuffer& buffer, std::string filename);
+	static void writeHeatmapToFile(const DebugBuffers& buffers, const DebugBufferType type, std::string filename);
+
+	/*
+	Binary (P6) encoding, used by FrameSink where the text format is too slow.
+	*/
+	static std::vector<unsigned char> encodePixels(const FrameBuffer& buffer);
 };
@@ -0,0 +1,49 @@
+#pragma once
+
+/*
+Counters gathered by Renderer::pipeline when SR_ENABLE_PROFILING is defined.
+*/
+struct PipelineStatistics
+{
+	/*
+	The raster loop steps half a pixel in x and y, so a triangle covering a pixel yields about this many fragments there.
+	*/
+	static constexpr int samplesPerPixel = 4;
+
+	long long verticesShaded = 0;
+	long long trianglesCulled = 0;
+	long long trianglesClipped = 0;
+	long long trianglesRasterized = 0;
+
+	/*
+	Raster samples tested. Samples near the edge of a screen band are tested by each band next to it.
+	*/
+	long long pixelsTested = 0;
+
+	/*
+	Fragments outside the screen, the clip rectangle or the tile mask, dropped before any test.
+	*/
+	long long fragmentsClipped = 0;
+	long long depthPasses = 0;
+	long long depthFails = 0;
+	/*
+	Part of depthFails rejected before the fragment shader ran.
+	*/
+	long long earlyDepthFails = 0;
+	long long stencilFails = 0;
+	long long fragmentsShaded = 0;
+
+	/*
+	Fragments that took the colour of a coarse shading block instead of calling the fragment shader.
+	*/
+	long long fragmentsBroadcast = 0;
+
+	/*
+	Average number of times a target pixel was shaded, counting broadcast fragments and normalized by samplesPerPixel,
+	so a single layer of coverage reads 1.
+	*/
+	double overdraw(const int pixelCount) const noexcept;
+
+	void reset() noexcept;
+	void add(const PipelineStatistics& other) noexcept;
+};
@@ -0,0 +1,173 @@
+#pragma once
+#include <utility>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "AlignedBuffer.hpp"
+#include "FrameBuffer.hpp"
+
+/*
+Linear float RGB image the post-process chain works on. Rows are width * 3 floats without padding.
+*/
+class PostProcessImage
+{
+public:
+	PostProcessImage();
+
+private:
+	int width = 0;
+	int height = 0;
+	AlignedBuffer pixels;
+
+public:
+	int getWidth() const;
+	int getHeight() const;
+
+	/*
+	Reallocates only when the image grows, so the chain reuses its buffers from frame to frame.
+	*/
+	void resize(const int width, const int height);
+
+	const float* row(const int y) const;
+	float* mutableRow(const int y);
+
+	/*
+	Bilinear sample at pixel coordinates, clamped to the edges.
+	*/
+	glm::vec3 sample(const float x, const float y) const;
+};
+
+/*
+What an effect pass reads besides the pixel it writes. Pixel passes run in place and consecutive ones are fused into
+one sweep over the image; neighbourhood passes need the previous image intact and write into the other buffer.
+*/
+enum class PostProcessInput
+{
+	pixel,
+	neighbourhood
+};
+
+class PostProcessEffect
+{
+public:
+	virtual ~PostProcessEffect() = default;
+
+	virtual int getPassCount() const;
+	virtual PostProcessInput getInput(const int pass) const = 0;
+
+	/*
+	Size of the image pass writes for an input of inputSize.
+	*/
+	virtual glm::ivec2 getOutputSize(const int pass, const glm::ivec2 inputSize) const;
+
+	/*
+	Writes rows [firstRow, lastRow) of destination. Called concurrently for disjoint row bands; pixel passes get the same
+	image as source and destination.
+	*/
+	virtual void run(const int pass, const PostProcessImage& source, PostProcessImage& destination, const int firstRow, const int lastRow) const = 0;
+};
+
+enum class ToneMapOperator
+{
+	reinhard,
+	aces
+};
+
+/*
+Scales by exposure and compresses with the operator. The frame buffer stores 8 bit colour, so values clipped while
+rendering stay clipped; the curve still rolls off bright regions and exposure brightens or darkens the frame.
+*/
+class ToneMapEffect : public PostProcessEffect
+{
+public:
+	ToneMapOperator toneMapOperator = ToneMapOperator::aces;
+	float exposure = 1.0f;
+
+	virtual PostProcessInput getInput(const int pass) const override;
+	virtual void run(const int pass, const PostProcessImage& source, PostProcessImage& destination, const int firstRow, const int lastRow) const override;
+};
+
+class GammaEffect : public PostProcessEffect
+{
+public:
+	float gamma = 2.2f;
+
+	virtual PostProcessInput getInput(const int pass) const override;
+	virtual void run(const int pass, const PostProcessImage& source, PostProcessImage& destination, const int firstRow, const int lastRow) const override;
+};
+
+/*
+Fast approximate anti-aliasing: blends along the local luma gradient where the contrast of a pixel's neighbourhood
+exceeds the thresholds. Runs best after tone mapping and gamma, on the colours that end up on screen.
+*/
+class FxaaEffect : public PostProcessEffect
+{
+public:
+	float contrastThreshold = 1.0f / 16.0f;
+	float relativeThreshold = 1.0f / 8.0f;
+	float spanMax = 8.0f;
+
+	virtual PostProcessInput getInput(const int pass) const override;
+	virtual void run(const int pass, const PostProcessImage& source, PostProcessImage& destination, const int firstRow, const int lastRow) const override;
+};
+
+/*
+Gaussian blur as a horizontal and a vertical pass; the kernel covers three standard deviations.
+*/
+class GaussianBlurEffect : public PostProcessEffect
+{
+public:
+	explicit GaussianBlurEffect(const float sigma = 2.0f);
+
+private:
+	std::vector<float> weights;
+	int radius = 0;
+
+public:
+	virtual int getPassCount() const override;
+	virtual PostProcessInput getInput(const int pass) const override;
+	virtual void run(const int pass, const PostProcessImage& source, PostProcessImage& destination, const int firstRow, const int lastRow) const override;
+};
+
+/*
+Halves width and height with a 2x2 box filter; the last row or column of an odd sized image is repeated.
+*/
+class DownsampleEffect : public PostProcessEffect
+{
+public:
+	virtual PostProcessInput getInput(const int pass) const override;
+	virtual glm::ivec2 getOutputSize(const int pass, const glm::ivec2 inputSize) const override;
+	virtual void run(const int pass, const PostProcessImage& source, PostProcessImage& destination, const int firstRow, const int lastRow) const override;
+};
+
+/*
+Ordered list of effects run on a finished frame. The frame is converted to float once, every pass works on two images
+that are reused between passes and frames, and the result is converted back once. Passes are split into bands of rows
+that run as JobSystem jobs. Effects are not owned and must outlive the chain.
+*/
+class PostProcessChain
+{
+public:
+	static constexpr int rowsPerJob = 16;
+
+private:
+	std::vector<PostProcessEffect*> effects;
+	PostProcessImage images[2];
+	std::vector<std::pair<const PostProcessEffect*, int>> pixelPasses;
+
+public:
+	void add(PostProcessEffect* effect);
+	void clear();
+	bool isEmpty() const;
+
+	/*
+	Size of the image the chain produces from a frame of inputSize.
+	*/
+	glm::ivec2 getOutputSize(const glm::ivec2 inputSize) const;
+
+	/*
+	target must have the output size for source; it may be source itself when the chain keeps the size.
+	*/
+	void run(const FrameBuffer& source, FrameBuffer& target);
+};
@@ -0,0 +1,124 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+
+/*
+Scoped stage timers that can be dumped as Chrome trace JSON (chrome://tracing, Perfetto).
+SR_PROFILE_SCOPE records one event per scope. Stages that run many times inside a loop, e.g. once per triangle, are
+summed instead: SR_PROFILE_STAGES declares the accumulator and SR_PROFILE_STAGE times one pass of a stage into it.
+SR_PROFILE_* and SR_STAT_ADD expand to nothing unless SR_ENABLE_PROFILING is defined.
+*/
+#if defined(SR_ENABLE_PROFILING)
+#define SR_PROFILE_CONCAT_INNER(a, b) a##b
+#define SR_PROFILE_CONCAT(a, b) SR_PROFILE_CONCAT_INNER(a, b)
+#define SR_PROFILE_SCOPE(name) ProfileScope SR_PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define SR_PROFILE_STAGES(stages) ProfileStages stages
+#define SR_PROFILE_STAGE(stages, name) ProfileStageScope SR_PROFILE_CONCAT(profileStage, __LINE__)(stages, name)
+#define SR_STAT_ADD(statistics, counter, value) ((statistics).counter += (value))
+#else
+#define SR_PROFILE_SCOPE(name)
+#define SR_PROFILE_STAGES(stages)
+#define SR_PROFILE_STAGE(stages, name)
+#define SR_STAT_ADD(statistics, counter, value)
+#endif
+
+class Profiler
+{
+public:
+	static Profiler& get();
+
+private:
+	Profiler();
+
+	struct Event
+	{
+		const char* name;
+		double start;
+		double duration;
+	};
+
+	/*
+	Events of one thread. Its mutex is only contended while a trace is written or cleared.
+	*/
+	struct ThreadEvents
+	{
+		std::mutex mutex;
+		std::vector<Event> events;
+		int threadIndex = 0;
+		size_t droppedCount = 0;
+	};
+
+	/*
+	Events past this are dropped and counted, so a long run can not grow the trace without bound.
+	*/
+	static constexpr size_t maxEventsPerThread = 1 << 20;
+
+	std::mutex mutex;
+	std::vector<std::unique_ptr<ThreadEvents>> threads;
+	std::chrono::steady_clock::time_point origin;
+
+	ThreadEvents& getThreadEvents();
+
+public:
+	void addEvent(const char* name, const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end);
+	void clear();
+	bool writeChromeTrace(const std::string& filename);
+};
+
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name);
+	~ProfileScope();
+
+private:
+	const char* name;
+	std::chrono::steady_clock::time_point start;
+};
+
+/*
+Sums the time of stages that interleave in a loop. When destroyed it records one event per stage, laid end to end
+from its construction, so the trace shows each stage's share of the loop at the cost of a few events.
+*/
+class ProfileStages
+{
+public:
+	ProfileStages();
+	~ProfileStages();
+	ProfileStages(const ProfileStages&) = delete;
+	ProfileStages& operator=(const ProfileStages&) = delete;
+
+	static constexpr int maxStageCount = 8;
+
+private:
+	struct Stage
+	{
+		const char* name;
+		std::chrono::steady_clock::duration duration;
+	};
+
+	Stage stages[maxStageCount];
+	int stageCount = 0;
+	std::chrono::steady_clock::time_point start;
+
+public:
+	/*
+	Stages are matched by the address of their name, which should be a string literal.
+	*/
+	void add(const char* name, const std::chrono::steady_clock::duration duration);
+};
+
+class ProfileStageScope
+{
+public:
+	ProfileStageScope(ProfileStages& stages, const char* name);
+	~ProfileStageScope();
+
+private:
+	ProfileStages& stages;
+	const char* name;
+	std::chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "FrameBuffer.hpp"
+
+/*
+Encoder for the "Quite OK Image" format (https://qoiformat.org), 3 channels, sRGB.
+*/
+class QOI
+{
+public:
+	static std::vector<unsigned char> encodePixels(const FrameBuffer& buffer);
+	static void writePxielsToFile(const FrameBuffer& buffer, std::string filename);
+};
@@ -10,4 +10,20 @@ struct Rect
 	double height;
 
 	static Rect boundingBox(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c) noexcept;
-};
\ No newline at end of file
+};
+
+/*
+Rectangle of whole pixels, in the pixel indices of FrameBuffer::ndcPointToPixelIndex (row 0 is the first row in memory).
+An empty rectangle stands for the whole frame buffer where it is used as viewport or scissor.
+*/
+struct PixelRect
+{
+	int x = 0;
+	int y = 0;
+	int width = 0;
+	int height = 0;
+
+	bool isEmpty() const noexcept;
+	bool contains(const int px, const int py) const noexcept;
+	PixelRect intersect(const PixelRect& other) const noexcept;
+};
@@ -3,14 +3,93 @@
 #include <functional>
 #include <vector>
 
-#include "DepthFunc.hpp"
+#include "DepthStencilState.hpp"
 #include "Shader.hpp"
+#include "Mesh.hpp"
+#include "VertexLayout.hpp"
+#include "Rect.hpp"
+#include "TileMask.hpp"
+
+/*
+Pixels covered by one fragment shader call, see RenderPipeline::shadingRate.
+*/
+enum class ShadingRate : unsigned char
+{
+	rate1x1 = 1,
+	rate2x2 = 2,
+	rate4x4 = 4
+};
 
 class RenderPipeline
 {
 public:
-	DepthFunc::closure depthFunc = DepthFunc::less;
-	void* vertexBuffer = nullptr;
+	DepthStencilState depthStencil;
+	const void* vertexBuffer = nullptr;
 	Shader* shader = nullptr;
 	int triangleCount = 0;
+
+	/*
+	Optional. When set, triangle i uses vertices indexBuffer[3 * i + 0..2] and each of the vertexCount vertices is shaded once.
+	*/
+	const unsigned int* indexBuffer = nullptr;
+	int vertexCount = 0;
+
+	/*
+	Optional. When not empty the pipeline gathers the attributes itself and calls Shader::vertexShader(const VertexInput&);
+	vertexBuffer is ignored.
+	*/
+	VertexLayout vertexLayout;
+
+	/*
+	The whole draw is repeated instanceCount times. When instanceBuffer is set, the vertex shader gets a pointer to
+	record instanceIdx (instanceStride bytes apart) through VertexInput::instance, e.g. a ModelInstance.
+	*/
+	int instanceCount = 1;
+	const void* instanceBuffer = nullptr;
+	int instanceStride = 0;
+
+	/*
+	Pixels of the frame buffer that NDC [-1, 1] is mapped to; empty maps to the whole buffer.
+	*/
+	PixelRect viewport;
+
+	/*
+	Only pixels inside the scissor rectangle are rasterized and written; empty disables the test.
+	*/
+	PixelRect scissor;
+
+	/*
+	Optional. Only pixels in the set tiles are rasterized and written, on top of the scissor test; the mask must match
+	the frame buffer size. Pixels come out as in a draw without the mask. With coarse shading the tile size must be a
+	multiple of 4.
+	*/
+	const TileMask* tileMask = nullptr;
+
+	/*
+	Depth-only draws run the depth and stencil tests and write depth (and stencil) only: no varyings are interpolated,
+	the fragment shader is not called and no color is written. Pair with a position only shader such as DepthShader.
+	*/
+	bool isDepthOnly = false;
+
+	/*
+	Coarse shading: the fragment shader runs once per block of rate x rate pixels and triangle, and its colour is
+	broadcast to every pixel of the block the triangle covers. Depth and stencil are still tested per pixel.
+	The shader sees the varyings of the first fragment of the block that passes the depth test.
+	Suits flat shaded faces and blurry or distant regions.
+	*/
+	ShadingRate shadingRate = ShadingRate::rate1x1;
+
+	/*
+	Optional rate per tile of shadingRateTileSize pixels (a multiple of 4), row by row over the frame buffer.
+	A pixel uses the coarser of its tile's rate and shadingRate.
+	*/
+	const ShadingRate* shadingRateTiles = nullptr;
+	int shadingRateTileSize = 16;
+
+	void setMesh(const Mesh& mesh);
+
+	/*
+	Like setMesh, but streams only the positions (a glm::vec3 at the start of every vertex) through vertexLayout.
+	*/
+	void setPositionStream(const Mesh& mesh);
 };
@@ -1,5 +1,5 @@
 #pragma once
-#include <functional>
+#include <vector>
 
 #include "FrameBuffer.hpp"
 #include "Rect.hpp"
@@ -7,8 +7,12 @@
 #include "Line2D.hpp"
 #include "DepthFunc.hpp"
 #include "RenderPipeLine.hpp"
+#include "CommandBuffer.hpp"
 #include "Shader.hpp"
 #include "ModelShader.hpp"
+#include "PipelineStatistics.hpp"
+#include "DebugBuffers.hpp"
+#include "FrameArena.hpp"
 
 enum PolygonModeType
 {
@@ -16,25 +20,89 @@ enum PolygonModeType
 	fill
 };
 
+/*
+A renderer owns its frame buffer, stamp buffers and statistics and is used by one thread at a time.
+Any number of renderers can draw concurrently; meshes and textures are read only while drawing and are shared without locks.
+The vertex stage of every renderer and the screen bands of its large draws run on the shared JobSystem.
+*/
 class Renderer
 {
 public:
-	Renderer(int width, int height);
+	Renderer(int width, int height, const FrameBufferOrigin origin = FrameBufferOrigin::topLeft);
+
+	/*
+	Draws into a frame buffer owned by the caller, e.g. a view of one region of a larger target.
+	*/
+	Renderer(FrameBuffer& target);
 	~Renderer();
 
 private:
+	struct Fragment
+	{
+		BarycentricTestResult testResult;
+		glm::vec3 point;
+		glm::vec4 color;
+		int bufferIndex = 0;
+		bool isRejected = false;
+	};
+
 	FrameBuffer* frameBuffer = nullptr;
+	bool ownsFrameBuffer = true;
+
+	/*
+	Triangle that last produced a fragment for each pixel; lets stencil draws take one fragment per pixel and triangle.
+	*/
+	std::vector<unsigned int> pixelStamps;
+	unsigned int currentStamp = 0;
+
+	/*
+	Colour shaded for each coarse block, keyed by the block's top left 2x2 cell, and the triangle that shaded it.
+	*/
+	std::vector<glm::vec4> coarseColors;
+	std::vector<unsigned int> coarseStamps;
+	PipelineStatistics statistics;
+	DebugBuffers* debugBuffers = nullptr;
+
+	/*
+	Vertex outputs, interpolation scratch and whatever the caller allocates from it between two flushes.
+	*/
+	FrameArena frameArena;
 
 public:
 	FrameBuffer const * const getFrameBuffer() const;
-	void flush() const;
+	FrameBuffer* mutableFrameBuffer();
+
+	/*
+	Starts a frame: clears the frame buffer and resets the frame arena, which invalidates everything allocated from it.
+	*/
+	void flush();
+
+	/*
+	Starts a frame that keeps the pixels outside tiles: resets the frame arena and sets the tiles to color, depth 1
+	and stencil 0. Nothing is cleared when no tile is set.
+	*/
+	void flush(const TileMask& tiles, const glm::vec3 color);
 	void clear(glm::vec3 color);
 
+	const PipelineStatistics& getStatistics() const;
+	void resetStatistics();
+
+	/*
+	Arena of the calling thread for data that only has to live until the next flush.
+	*/
+	LinearArena& getFrameArena();
+	ArenaStatistics getFrameArenaStatistics() const;
+
+	/*
+	Attaches optional diagnostic buffers (nullptr detaches). They must match the frame buffer size and are cleared by flush.
+	*/
+	void setDebugBuffers(DebugBuffers* debugBuffers);
+
 	int getWidth() const;
 	int getHeight() const;
 
-	void setColor(const glm::vec3 point, const glm::vec3 color, const std::function<bool(double, double)> depthFunc) const;
-	bool isAvailable(const glm::vec3 point, const std::function<bool(double, double)> depthFunc) const;
+	void setColor(const glm::vec3 point, const glm::vec3 color, const DepthFunc::closure depthFunc) const;
+	bool isAvailable(const glm::vec3 point, const DepthFunc::closure depthFunc) const;
 
 	void addLine2D(const glm::vec2 p0, const glm::vec2 p1, const glm::vec3 color) const;
 	void addLine2D(const Line2D line2D, const glm::vec3 color) const;
@@ -47,12 +115,64 @@ public:
 
 	void addTriangle3D(const glm::vec3 p0, const glm::vec3 p1, const glm::vec3 p2,
 		const glm::vec3 c0, const glm::vec3 c1, const glm::vec3 c2,
-		const std::function<bool(double, double)> depthFunc) const;
+		const DepthFunc::closure depthFunc) const;
 	void addTriangle3D(const glm::vec4 p0, const glm::vec4 p1, const glm::vec4 p2,
 		const glm::vec3 c0, const glm::vec3 c1, const glm::vec3 c2,
-		const std::function<bool(double, double)> depthFunc) const;
+		const DepthFunc::closure depthFunc) const;
 
+	/*
+	Draws renderPipeLine.instanceCount instances. Each instance runs the vertex stage once and rasterizes every triangle.
+	*/
 	void pipeline(const RenderPipeline& renderPipeLine);
 
+	/*
+	Sorts the recorded packets and draws them in that order.
+	*/
+	void execute(CommandBuffer& commandBuffer);
+
+	/*
+	Sets the tiles the draw may write: the bounding rectangles of its triangles, inside the viewport and scissor.
+	Runs the vertex stage only; tileMask of the pipeline is ignored.
+	*/
+	void coverage(const RenderPipeline& renderPipeLine, TileMask& tiles);
+
 	bool isValidTriangle(const glm::vec2 a, const glm::vec2 b, const glm::vec2 c) const;
+	bool isInsideNdc(const glm::vec2 point) const;
+
+private:
+	void shadeVertices(const RenderPipeline& renderPipeLine, const int instanceIdx, ArenaVector<RasterizationData>& vertices);
+	void drawTriangles(const RenderPipeline& renderPipeLine, const ArenaVector<RasterizationData>& vertices);
+
+	/*
+	drawTriangles specialized for one depth compare op, so the per pixel test is inlined.
+	*/
+	template<CompareOp depthCompare>
+	void drawTrianglesKernel(const RenderPipeline& renderPipeLine, const ArenaVector<RasterizationData>& vertices);
+	/*
+	Reserves count consecutive stamps and returns the first; clears the stamp arrays when the range would wrap.
+	*/
+	unsigned int reserveStamps(const unsigned int count);
+
+	/*
+	Pixels the viewport and the scissor leave to a draw.
+	*/
+	PixelRect pipelineClipRect(const RenderPipeline& renderPipeLine) const;
+
+	/*
+	Largest distance in NDC between a sample of a triangle with the screen box and clip z values and the perspective
+	corrected point its fragment lands on. Infinite when the z values differ in sign: the corrected weights can then be
+	negative and the point can land anywhere, so every sample of the box has to be visited.
+	*/
+	static glm::vec2 perspectiveMargin(const Rect& box, const double z0, const double z1, const double z2);
+
+	/*
+	Pixels a triangle with the NDC bounding box may write, with a pixel of margin; may reach outside the frame buffer.
+	*/
+	PixelRect pixelBounds(const Rect& box) const;
+
+	/*
+	Scale (xy) and offset (zw) from the NDC of the viewport to the NDC of the whole frame buffer.
+	*/
+	glm::vec4 viewportTransform(const PixelRect& viewport) const;
+
 };
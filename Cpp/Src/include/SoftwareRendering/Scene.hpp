@@ -0,0 +1,83 @@
+#pragma once
+#include <functional>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "BoundingBox.hpp"
+#include "BVH.hpp"
+#include "Frustum.hpp"
+#include "Mesh.hpp"
+#include "OcclusionBuffer.hpp"
+#include "Shader.hpp"
+
+class Renderer;
+
+struct SceneNode
+{
+	int parent = -1;
+	glm::mat4x4 localTransform = glm::mat4x4(1.0f);
+	glm::mat4x4 worldTransform = glm::mat4x4(1.0f);
+	const Mesh* mesh = nullptr;
+	BoundingBox worldBounds;
+	bool isOccluder = false;
+};
+
+/*
+Flat list of nodes with parent links. A parent is always added before its children, so world transforms
+are resolved in one pass over the list. Nodes with a mesh are kept in a BVH for frustum culling.
+*/
+class Scene
+{
+private:
+	std::vector<SceneNode> nodes;
+	std::vector<int> drawableNodes;
+	std::vector<BoundingBox> drawableBounds;
+	std::vector<int> visibleItems;
+	std::vector<ModelInstance> instances;
+	BVH bvh;
+	bool isStructureDirty = true;
+
+public:
+	/*
+	Returns the index of the new node. mesh may be nullptr for pure transform nodes.
+	*/
+	int addNode(const Mesh* mesh, const glm::mat4x4& localTransform, const int parent = -1);
+	void setLocalTransform(const int nodeIndex, const glm::mat4x4& localTransform);
+
+	/*
+	Occluders are rasterized into the OcclusionBuffer by renderOccluders. Large, simple meshes such as walls work best.
+	*/
+	void setOccluder(const int nodeIndex, const bool isOccluder);
+
+	const SceneNode& getNode(const int nodeIndex) const;
+	int getNodeCount() const;
+
+	/*
+	Resolves world transforms and bounds, then rebuilds the BVH if nodes were added and refits it otherwise.
+	*/
+	void update();
+
+	/*
+	Rasterizes the occluder nodes inside the frustum. Call after update and OcclusionBuffer::begin.
+	*/
+	void renderOccluders(OcclusionBuffer& occlusionBuffer, const Frustum& frustum);
+
+	/*
+	Indices of the nodes with a mesh whose world bounds intersect the frustum. With an occlusionBuffer, nodes other
+	than occluders are also dropped when hidden behind the occluders.
+	*/
+	void cull(const Frustum& frustum, std::vector<int>& visibleNodes, const OcclusionBuffer* occlusionBuffer = nullptr) const;
+
+	/*
+	Submits every visible node to renderer.pipeline. bindShader prepares the shader for the node, e.g. sets its model matrix.
+	Returns the number of nodes drawn.
+	*/
+	int draw(Renderer& renderer, const Frustum& frustum, const std::function<Shader*(const SceneNode&)>& bindShader, const OcclusionBuffer* occlusionBuffer = nullptr);
+
+	/*
+	Like draw, but visible nodes sharing a mesh are drawn with one instanced pipeline call. shader must read
+	ModelInstance records (ModelShader, ModelShader2); each instance gets the node world transform.
+	*/
+	int drawInstanced(Renderer& renderer, const Frustum& frustum, Shader* shader, const OcclusionBuffer* occlusionBuffer = nullptr);
+};
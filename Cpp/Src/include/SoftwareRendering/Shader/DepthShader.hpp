@@ -0,0 +1,29 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include "glm/ext/matrix_transform.hpp"
+
+#include "Shader.hpp"
+
+/*
+Position only shader for depth-only draws (RenderPipeline::isDepthOnly), e.g. z-prepasses and shadow maps.
+The position is layout attribute 0 (see RenderPipeline::setPositionStream), or else a glm::vec3 at the start of every
+vertexStride bytes of the vertex buffer. An instance record is read as ModelInstance and replaces modelMat.
+*/
+class DepthShader : public Shader
+{
+public:
+	glm::mat4x4 modelMat = glm::identity<glm::mat4x4>();
+	glm::mat4x4 viewMat = glm::identity<glm::mat4x4>();
+	glm::mat4x4 projectionMat = glm::identity<glm::mat4x4>();
+	int vertexStride = sizeof(glm::vec3);
+
+	virtual RasterizationData vertexShader(const void * vertexBuffer, const int vertexIdx) override;
+	virtual RasterizationData vertexShader(const VertexInput & input) override;
+	virtual bool supportsVertexLayout() const override;
+
+	/*
+	Not called by depth-only draws; returns white so a misconfigured color draw is visible.
+	*/
+	virtual glm::vec4 fragmentShader(const RasterizationData & rasterizationData) override;
+};
@@ -19,7 +19,13 @@ struct ImageShaderVertex
 class ImageShader : public Shader
 {
 public:
-	Texture2D* texture = nullptr;
+	const Texture2D* texture = nullptr;
 	virtual RasterizationData vertexShader(const void * vertex, const int vertexIdx) override;
+
+	/*
+	Layout attribute 0 is the position, attribute 1 the uv.
+	*/
+	virtual RasterizationData vertexShader(const VertexInput & input) override;
+	virtual bool supportsVertexLayout() const override;
 	virtual glm::vec4 fragmentShader(const RasterizationData & rasterizationData) override;
 };
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "Shader.hpp"
+#include "FrameBuffer.hpp"
 
 struct BaseVertex
 {
@@ -17,6 +18,22 @@ public:
 	glm::mat4x4 viewMat;
 	glm::mat4x4 projectionMat;
 
+	/*
+	Optional shadow map: the depth of a depth-only draw with lightViewProjectionMat. Fragments farther from the light than
+	the stored depth plus shadowBias are darkened by shadowIntensity.
+	*/
+	const FrameBuffer* shadowMap = nullptr;
+	glm::mat4x4 lightViewProjectionMat = glm::mat4x4(1.0f);
+	float shadowBias = 0.005f;
+	float shadowIntensity = 0.5f;
+
 	virtual RasterizationData vertexShader(const void * vertexBuffer, const int vertexIdx) override;
+
+	/*
+	Layout attribute 0 is the position, attribute 1 the color. An instance record is read as ModelInstance
+	and replaces modelMat; its tint multiplies the output color.
+	*/
+	virtual RasterizationData vertexShader(const VertexInput & input) override;
+	virtual bool supportsVertexLayout() const override;
 	virtual glm::vec4 fragmentShader(const RasterizationData & rasterizationData) override;
 };
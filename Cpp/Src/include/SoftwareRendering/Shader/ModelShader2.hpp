@@ -18,9 +18,16 @@ public:
 	glm::mat4x4 modelMat = glm::identity<glm::mat4x4>();
 	glm::mat4x4 viewMat = glm::identity<glm::mat4x4>();
 	glm::mat4x4 projectionMat = glm::identity<glm::mat4x4>();
-	Texture2D *texture = nullptr;
+	const Texture2D* texture = nullptr;
 
 	virtual RasterizationData vertexShader(const void * vertexBuffer, const int vertexIdx) override;
+
+	/*
+	Layout attribute 0 is the position, attribute 1 the texture coordinates. An instance record is read as ModelInstance
+	and replaces modelMat; its tint multiplies the output color.
+	*/
+	virtual RasterizationData vertexShader(const VertexInput & input) override;
+	virtual bool supportsVertexLayout() const override;
 	virtual glm::vec4 fragmentShader(const RasterizationData & rasterizationData) override;
 };
 
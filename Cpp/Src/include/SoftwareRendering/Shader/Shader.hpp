@@ -4,15 +4,63 @@
 
 #include "glm/glm.hpp"
 
+#include "FrameArena.hpp"
+
+/*
+extraData comes from the frame arena of the renderer while drawing and from the heap otherwise.
+*/
 struct RasterizationData
 {
 	glm::vec4 position;
-	std::vector<glm::vec4> extraData;
+	ArenaVector<glm::vec4> extraData;
+};
+
+/*
+Input of one vertex for layout or instanced draws.
+attributes holds the vertex gathered through RenderPipeline::vertexLayout, in the order they were added to the layout;
+without a layout it is nullptr and the vertex is read from vertexBuffer instead.
+instance points at the record of RenderPipeline::instanceBuffer for this instance, or is nullptr.
+*/
+struct VertexInput
+{
+	const glm::vec4* attributes = nullptr;
+	int attributeCount = 0;
+	const void* vertexBuffer = nullptr;
+	int vertexIdx = 0;
+	const void* instance = nullptr;
+	int instanceIdx = 0;
+};
+
+/*
+Per instance record understood by ModelShader and ModelShader2.
+*/
+struct ModelInstance
+{
+	glm::mat4x4 modelMat = glm::mat4x4(1.0f);
+	glm::vec4 tint = glm::vec4(1.0f);
 };
 
+/*
+vertexShader and fragmentShader are called concurrently on JobSystem threads, for blocks of vertices and for screen
+bands of a draw, and must not modify the shader.
+Uniforms live in the shader, so renderers drawing at the same time each need their own shader object.
+*/
 class Shader
 {
 public:
 	virtual RasterizationData vertexShader(const void* vertexBuffer, const int vertexIdx) = 0;
+
+	/*
+	Called instead of the vertexBuffer variant when the pipeline has a vertex layout or an instance buffer.
+	Shaders that only read their own vertex struct do not need to override it: without a layout the default calls the
+	vertexBuffer variant and ignores the instance.
+	*/
+	virtual RasterizationData vertexShader(const VertexInput& input);
+
+	/*
+	True if vertexShader(const VertexInput&) reads input.attributes. Renderer::pipeline skips layout draws otherwise.
+	*/
+	virtual bool supportsVertexLayout() const;
+
 	virtual glm::vec4 fragmentShader(const RasterizationData& rasterizationData) = 0;
 };
@@ -0,0 +1,177 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <string>
+
+#include "FrameBuffer.hpp"
+
+enum class SharedFrameFormat : uint32_t
+{
+	/*
+	3 bytes per pixel, red first, rows rowBytes apart in the order of FrameBufferOrigin.
+	*/
+	rgb8 = 1
+};
+
+/*
+One frame of the ring. sequence is odd while the producer writes the slot and grows by two with every frame written.
+*/
+struct SharedFrameSlot
+{
+	std::atomic<uint64_t> sequence;
+	std::atomic<uint64_t> frameIndex;
+};
+
+/*
+Start of a shared memory region written by SharedFrameBuffer. Followed by slotCount frames of slotBytes each, the
+first at slotOffset from the start of the region. Fields use the byte order of the machine; only publishedFrames,
+latestSlot and the slots change after creation, so consumers written in other languages can follow SharedFrameReader.
+*/
+struct SharedFrameHeader
+{
+	static constexpr uint32_t currentVersion = 1;
+	static constexpr int maxSlotCount = 4;
+
+	char magic[4];
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t rowBytes;
+	SharedFrameFormat format;
+	FrameBufferOrigin origin;
+	uint32_t slotCount;
+	uint64_t slotOffset;
+	uint64_t slotBytes;
+
+	/*
+	Frames published so far; also the frameIndex of the next one.
+	*/
+	std::atomic<uint64_t> publishedFrames;
+	std::atomic<uint32_t> latestSlot;
+	SharedFrameSlot slots[maxSlotCount];
+};
+
+// The layout is read by other processes and languages; these pin it on every compiler.
+static_assert(sizeof(SharedFrameSlot) == 16, "SharedFrameSlot layout changed");
+static_assert(offsetof(SharedFrameHeader, magic) == 0 && offsetof(SharedFrameHeader, version) == 4
+	&& offsetof(SharedFrameHeader, width) == 8 && offsetof(SharedFrameHeader, height) == 12
+	&& offsetof(SharedFrameHeader, rowBytes) == 16 && offsetof(SharedFrameHeader, format) == 20
+	&& offsetof(SharedFrameHeader, origin) == 24 && offsetof(SharedFrameHeader, slotCount) == 28
+	&& offsetof(SharedFrameHeader, slotOffset) == 32 && offsetof(SharedFrameHeader, slotBytes) == 40
+	&& offsetof(SharedFrameHeader, publishedFrames) == 48 && offsetof(SharedFrameHeader, latestSlot) == 56
+	&& offsetof(SharedFrameHeader, slots) == 64, "SharedFrameHeader layout changed");
+static_assert(sizeof(SharedFrameHeader) == 64 + sizeof(SharedFrameSlot) * SharedFrameHeader::maxSlotCount,
+	"SharedFrameHeader layout changed");
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+	"shared memory atomics must not rely on a process local lock");
+
+/*
+Frame buffer whose color lives in a named shared memory region, so local consumers such as encoders and compositors
+read finished frames without a copy. Render into getFrameBuffer(), e.g. through Renderer(FrameBuffer&), then publish;
+publish moves the frame buffer to the next slot of the ring and never waits for readers. Readers detect a slot that
+was reused under them with the slot sequence, see SharedFrameReader. The region is removed when the producer is
+destroyed; readers that still map it keep their mapping.
+*/
+class SharedFrameBuffer
+{
+public:
+	~SharedFrameBuffer();
+	SharedFrameBuffer(const SharedFrameBuffer&) = delete;
+	SharedFrameBuffer& operator=(const SharedFrameBuffer&) = delete;
+
+	/*
+	name follows shm_open, e.g. "/software-rendering". An existing region of that name is replaced.
+	Returns nullptr if the region can not be created.
+	*/
+	static SharedFrameBuffer* create(const std::string& name, int width, int height,
+		const FrameBufferOrigin origin = FrameBufferOrigin::topLeft, const int slotCount = 3);
+
+private:
+	SharedFrameBuffer();
+
+	std::string name;
+	void* mappedData = nullptr;
+	size_t mappedSize = 0;
+#if defined(_WIN32)
+	void* mappingHandle = nullptr;
+#endif
+	SharedFrameHeader* header = nullptr;
+	FrameBuffer* frameBuffer = nullptr;
+	int writeSlot = 0;
+
+public:
+	/*
+	Frame buffer of the slot being written. Its color keeps whatever the slot held before, so start each frame with
+	a flush or clear; depth and stencil are not shared.
+	*/
+	FrameBuffer& getFrameBuffer();
+
+	/*
+	Makes the frame in getFrameBuffer() the latest one and moves the frame buffer to the slot written longest ago.
+	*/
+	void publish();
+
+	uint64_t getPublishedFrames() const;
+
+private:
+	unsigned char* slotData(const int slot) const;
+};
+
+/*
+A frame acquired by SharedFrameReader. data points into the shared region and stays mapped while the reader lives.
+*/
+struct SharedFrame
+{
+	const unsigned char* data = nullptr;
+	int width = 0;
+	int height = 0;
+	int rowBytes = 0;
+	FrameBufferOrigin origin = FrameBufferOrigin::topLeft;
+	uint64_t frameIndex = 0;
+	int slot = 0;
+	uint64_t sequence = 0;
+};
+
+/*
+Read only mapping of a region created by SharedFrameBuffer. Reading follows a sequence lock: acquire the latest frame,
+read its pixels in place, then check isValid; if the producer reused the slot meanwhile, drop what was read and
+acquire again. Neither side ever blocks the other.
+*/
+class SharedFrameReader
+{
+public:
+	~SharedFrameReader();
+	SharedFrameReader(const SharedFrameReader&) = delete;
+	SharedFrameReader& operator=(const SharedFrameReader&) = delete;
+
+	/*
+	Returns nullptr if the region does not exist or was not written by this version.
+	*/
+	static SharedFrameReader* open(const std::string& name);
+
+private:
+	SharedFrameReader();
+
+	const void* mappedData = nullptr;
+	size_t mappedSize = 0;
+#if defined(_WIN32)
+	void* mappingHandle = nullptr;
+#endif
+	const SharedFrameHeader* header = nullptr;
+
+public:
+	int getWidth() const;
+	int getHeight() const;
+	uint64_t getPublishedFrames() const;
+
+	/*
+	Latest published frame; false while nothing is published.
+	*/
+	bool acquire(SharedFrame& frame) const;
+
+	/*
+	True while the producer has not started to overwrite the slot of frame. Call after reading the pixels.
+	*/
+	bool isValid(const SharedFrame& frame) const;
+};
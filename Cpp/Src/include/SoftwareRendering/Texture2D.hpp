@@ -10,12 +10,17 @@ enum class TextureWrappingType
 	clampToBorder
 };
 
+/*
+The pixels are never modified after loading, so one texture can be sampled by any number of renderers at once.
+Shaders refer to it by pointer; it is not copyable.
+*/
 class Texture2D
 {
 public:
 	Texture2D(const std::string& filePath);
 	~Texture2D();
-	Texture2D & operator=(const Texture2D & t);
+	Texture2D(const Texture2D& t) = delete;
+	Texture2D & operator=(const Texture2D & t) = delete;
 
 public:
 	glm::vec4 sample(const glm::vec2& uv) const;
@@ -0,0 +1,96 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "CommandBuffer.hpp"
+#include "Mesh.hpp"
+#include "Renderer.hpp"
+#include "TileMask.hpp"
+
+/*
+Redraws only the screen tiles that changed since the last frame, for mostly static scenes. Every frame submits its
+draws in a stable order, each with a hash of the inputs the pipeline does not show. A draw whose pipeline or hash
+differs from the draw at the same position in the last frame, and every draw that was added or removed, marks the
+tiles it covered then and covers now as dirty. Dirty tiles are cleared, the draws covering them are drawn again in
+submission order restricted to those tiles, and every other pixel is kept. A frame without changes draws nothing.
+The result matches a full redraw of the frame, as the rasterizer keeps its sample grid under a tile mask.
+Nothing else may draw into the renderer between two frames.
+*/
+class TileCache
+{
+public:
+	explicit TileCache(Renderer& renderer, const int tileSize = 32);
+	TileCache(const TileCache&) = delete;
+	TileCache& operator=(const TileCache&) = delete;
+
+	glm::vec3 clearColor = glm::vec3(0.0f);
+
+private:
+	struct Draw
+	{
+		DrawPacket packet;
+		uint64_t inputHash = 0;
+
+		/*
+		Tiles the draw may write, see Renderer::coverage.
+		*/
+		TileMask coverage;
+	};
+
+	Renderer& renderer;
+	int tileSize = 32;
+
+	/*
+	Slots are reused from frame to frame, so the masks keep their storage; only the first drawCount are in use.
+	*/
+	std::vector<Draw> draws;
+	std::vector<Draw> previousDraws;
+	int drawCount = 0;
+	int previousDrawCount = 0;
+	TileMask dirtyTiles;
+	bool isValid = false;
+
+public:
+	/*
+	Starts recording the draws of a frame.
+	*/
+	void begin();
+
+	/*
+	inputHash must change whenever the draw looks different for a reason its pipeline does not show, e.g. the uniforms
+	set by bindUniforms, the mesh contents or the textures; see hashInputs. bindUniforms runs before every pass that
+	uses the draw.
+	*/
+	void submit(const DrawPacket& packet, const uint64_t inputHash);
+
+	/*
+	Redraws the dirty tiles and returns how many there were.
+	*/
+	int end();
+
+	/*
+	Redraws the whole frame on the next end, e.g. after something else drew into the renderer.
+	*/
+	void invalidate();
+
+	/*
+	Tiles the last end redrew.
+	*/
+	const TileMask& getDirtyTiles() const;
+
+	/*
+	Hash for submit of a draw of mesh with a transform and a hash of its material. Meshes are compared by address,
+	so their contents must not change while cached.
+	*/
+	static uint64_t hashInputs(const Mesh* mesh, const glm::mat4x4& transform, const uint64_t materialHash);
+
+	/*
+	FNV-1a over size bytes, continuing from hash.
+	*/
+	static uint64_t hashBytes(const void* data, const size_t size, const uint64_t hash = 14695981039346656037ull);
+
+private:
+	static uint64_t hashPipeline(const RenderPipeline& pipeline);
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+
+#include "Rect.hpp"
+
+/*
+Set of square screen tiles over a frame buffer of width x height pixels, in the pixel indices of PixelRect. The tiles of
+the last column and row are cut off at the edges.
+*/
+class TileMask
+{
+public:
+	TileMask();
+	TileMask(const int width, const int height, const int tileSize);
+
+private:
+	int width = 0;
+	int height = 0;
+	int tileSize = 0;
+	int columns = 0;
+	int rows = 0;
+	std::vector<unsigned char> tiles;
+
+public:
+	int getWidth() const;
+	int getHeight() const;
+	int getTileSize() const;
+	int getColumns() const;
+	int getRows() const;
+
+	/*
+	Unsets every tile. Keeps the storage when the mask does not grow.
+	*/
+	void resize(const int width, const int height, const int tileSize);
+
+	void clear();
+	void fill();
+	bool isEmpty() const;
+	int count() const;
+
+	bool isSet(const int column, const int row) const;
+	void set(const int column, const int row);
+	bool containsPixel(const int x, const int y) const;
+
+	/*
+	Sets every tile rect touches; the part outside the frame buffer is ignored.
+	*/
+	void addRect(const PixelRect& rect);
+
+	/*
+	other must have the same size and tile size.
+	*/
+	void add(const TileMask& other);
+	bool intersects(const TileMask& other) const;
+	bool intersects(const PixelRect& rect) const;
+
+	/*
+	Pixels of the tile, cut off at the frame buffer edges.
+	*/
+	PixelRect getTileRect(const int column, const int row) const;
+
+	/*
+	Smallest rectangle holding every set tile; empty when no tile is set.
+	*/
+	PixelRect getBounds() const;
+};
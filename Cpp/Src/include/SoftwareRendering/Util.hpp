@@ -22,6 +22,11 @@ double remapping(const double value, const double fromLower, const double fromUp
 
 glm::vec3 randomColor();
 
+/*
+False colour for t in [0, 1]: blue, cyan, green, yellow, red.
+*/
+glm::vec3 heatmapColor(const double t);
+
 std::string getFolder(const std::string filename);
 
 double interpolation(const glm::vec3 weight, const glm::vec3 value);
@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+
+#include "glm/glm.hpp"
+
+enum class VertexFormat
+{
+	float1,
+	float2,
+	float3,
+	float4,
+	unorm8x4
+};
+
+/*
+One shader input read from an external stream: element i starts at (const char*)stream + offset + i * stride.
+Missing components are filled with (0, 0, 0, 1).
+*/
+struct VertexAttribute
+{
+	const void* stream = nullptr;
+	int stride = 0;
+	int offset = 0;
+	VertexFormat format = VertexFormat::float3;
+};
+
+/*
+Describes where each shader input lives, so positions, normals and uvs can be read straight from separate arrays
+(aiMesh::mVertices, aiMesh::mTextureCoords, ...) without first copying them into an interleaved vertex struct.
+*/
+class VertexLayout
+{
+public:
+	static constexpr int maxAttributeCount = 8;
+
+private:
+	std::vector<VertexAttribute> attributes;
+
+public:
+	void addAttribute(const void* stream, const int stride, const int offset, const VertexFormat format);
+	void clear();
+
+	bool isEmpty() const;
+	int getAttributeCount() const;
+	const VertexAttribute& getAttribute(const int index) const;
+
+	/*
+	Converts vertices [firstVertex, firstVertex + count) to vec4, vertex major: out[i * getAttributeCount() + attribute].
+	*/
+	void gather(const int firstVertex, const int count, glm::vec4* out) const;
+
+	static int componentCount(const VertexFormat format);
+};
@@ -23,6 +23,10 @@
 #include "RenderPipeLine.hpp"
 #include "Texture2D.hpp"
 #include "ImageShader.hpp"
+#include "Profiler.hpp"
+#include "Mesh.hpp"
+#include "JobSystem.hpp"
+#include "DynamicResolution.hpp"
 
 struct GlobalResource
 {
@@ -35,6 +39,7 @@ struct GlobalResource
 	
 	const GLFWwindow* window = nullptr;
 	Renderer* renderer = nullptr;
+	DynamicResolution* dynamicResolution = nullptr;
 
 	Assimp::Importer* boxImporter = nullptr;
 	const aiScene* boxScene = nullptr;
@@ -47,6 +52,9 @@ struct GlobalResource
 	Assimp::Importer* boxWithTextureModelImporter = nullptr;
 	const aiScene* boxWithTextureModelScene = nullptr;
 
+	Mesh* boxMesh = nullptr;
+	Mesh* boxWithTextureMesh = nullptr;
+
 	GlobalResource(int argc, char ** argv)
 		:appPath(argv[0])
 	{
@@ -57,6 +65,25 @@ struct GlobalResource
 		texture = new Texture2D(testImagePath);
 		boxWithTextureModelImporter = new Assimp::Importer();
 		boxWithTextureModelScene = modeImporter->ReadFile(boxWithTextureModelPath, (aiProcess_Triangulate | aiProcess_JoinIdenticalVertices));
+
+		boxMesh = Mesh::fromScene<BaseVertex>(boxScene, [](const aiMesh* mesh, const aiMaterial* material, unsigned int index) {
+			aiColor4D diffuseColor;
+			material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuseColor);
+			const aiVector3D vertex = mesh->mVertices[index];
+			BaseVertex baseVertex;
+			baseVertex.position = glm::vec3(vertex.x, vertex.y, vertex.z);
+			baseVertex.color = glm::vec3(diffuseColor.r, diffuseColor.g, diffuseColor.b);
+			return baseVertex;
+		});
+
+		boxWithTextureMesh = Mesh::fromScene<BaseVertex2>(boxWithTextureModelScene, [](const aiMesh* mesh, const aiMaterial* material, unsigned int index) {
+			const aiVector3D vertex = mesh->mVertices[index];
+			const aiVector3D coords = mesh->mTextureCoords[0][index];
+			BaseVertex2 baseVertex;
+			baseVertex.position = glm::vec3(vertex.x, vertex.y, vertex.z);
+			baseVertex.textureCoords = glm::vec2(coords.x, coords.y);
+			return baseVertex;
+		});
 	}
 };
 
@@ -208,9 +235,10 @@ void drawImage()
 	ImageShader shader;
 	shader.texture = globalResource->texture;
 	RenderPipeline pipeline;
-	pipeline.depthFunc = DepthFunc::lequal;
+	pipeline.depthStencil.depthCompare = CompareOp::lequal;
 	pipeline.shader = &shader;
-	std::vector<ImageShaderVertex> vertexBuffer;
+	ArenaVector<ImageShaderVertex> vertexBuffer{ ArenaAllocator<ImageShaderVertex>(&renderer->getFrameArena()) };
+	vertexBuffer.reserve(6);
 	float length = 0.5;
 	ImageShaderVertex a = ImageShaderVertex(glm::vec2(-length, length), glm::vec2(0.0f, 0.0f));
 	ImageShaderVertex b = ImageShaderVertex(glm::vec2(length, length), glm::vec2(1.0f, 0.0f));
@@ -249,58 +277,13 @@ void testPipeLine(const float time)
 	glm::mat4x4 projectionMat = camera.GetprojectionMat();
 	//glm::mat4x4 mvpMat = projectionMat * viewMat * modelMat;
 
-	std::function<glm::vec3(aiMesh*, unsigned int)> getVertex = [renderer](aiMesh* mesh, unsigned int index) {
-		const aiVector3D vertex = mesh->mVertices[index];
-		return glm::vec3(vertex.x, vertex.y, vertex.z);
-	};
-
-	const aiScene* scene = globalResource->boxScene;
 	ModelShader shader;
 	shader.modelMat = modelMat;
 	shader.viewMat = viewMat;
 	shader.projectionMat = projectionMat;
 	RenderPipeline pipeline;
 	pipeline.shader = &shader;
-	std::vector<BaseVertex> vertexBuffer;
-	
-	for (int meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++)
-	{
-		aiMesh* mesh = scene->mMeshes[meshIndex];
-		aiMaterial* mMaterial = scene->mMaterials[mesh->mMaterialIndex];
-		aiColor4D diffuseColor;
-		aiReturn ret = mMaterial->Get(AI_MATKEY_COLOR_DIFFUSE, diffuseColor);
-
-		for (int faceIndex = 0; faceIndex < mesh->mNumFaces; faceIndex++)
-		{
-			aiFace face = mesh->mFaces[faceIndex];
-			assert(face.mNumIndices == 3);
-			const glm::vec3 a = getVertex(mesh, face.mIndices[0]);
-			const glm::vec3 b = getVertex(mesh, face.mIndices[1]);
-			const glm::vec3 c = getVertex(mesh, face.mIndices[2]);
-			
-			const glm::vec3 color0 = glm::vec3(diffuseColor.r, diffuseColor.g, diffuseColor.b);
-			const glm::vec3 color1 = color0;
-			const glm::vec3 color2 = color0;
-
-			BaseVertex vertex0;
-			vertex0.color = color0;
-			vertex0.position = a;
-			vertexBuffer.push_back(vertex0);
-
-			BaseVertex vertex1;
-			vertex1.color = color1;
-			vertex1.position = b;
-			vertexBuffer.push_back(vertex1);
-
-			BaseVertex vertex2;
-			vertex2.color = color2;
-			vertex2.position = c;
-			vertexBuffer.push_back(vertex2);
-		}
-	}
-	
-	pipeline.vertexBuffer = static_cast<void*>(vertexBuffer.data());
-	pipeline.triangleCount = vertexBuffer.size() / 3;
+	pipeline.setMesh(*globalResource->boxMesh);
 
 	renderer->pipeline(pipeline);
 }
@@ -327,16 +310,6 @@ void renderCube(const float time)
 	glm::mat4x4 projectionMat = camera.GetprojectionMat();
 	//glm::mat4x4 mvpMat = projectionMat * viewMat * modelMat;
 
-	std::function<BaseVertex2(aiMesh*, unsigned int)> getVertex = [renderer](aiMesh* mesh, unsigned int index) {
-		BaseVertex2 baseVertex;
-		const aiVector3D vertex = mesh->mVertices[index];
-		const aiVector3D coords = mesh->mTextureCoords[0][index];
-		baseVertex.position = glm::vec3(vertex.x, vertex.y, vertex.z);
-		baseVertex.textureCoords = glm::vec2(coords.x, coords.y);
-		return baseVertex;
-	};
-
-	const aiScene* scene = globalResource->boxWithTextureModelScene;
 	ModelShader2 shader;
 	shader.modelMat = modelMat;
 	shader.viewMat = viewMat;
@@ -344,44 +317,33 @@ void renderCube(const float time)
 	shader.texture = globalResource->texture;
 	RenderPipeline pipeline;
 	pipeline.shader = &shader;
-	std::vector<BaseVertex2> vertexBuffer;
-
-	for (int meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++)
-	{
-		aiMesh* mesh = scene->mMeshes[meshIndex];
-
-		for (int faceIndex = 0; faceIndex < mesh->mNumFaces; faceIndex++)
-		{
-			aiFace face = mesh->mFaces[faceIndex];
-			assert(face.mNumIndices == 3);
-			const BaseVertex2 vertex0 = getVertex(mesh, face.mIndices[0]);
-			const BaseVertex2 vertex1 = getVertex(mesh, face.mIndices[1]);
-			const BaseVertex2 vertex2 = getVertex(mesh, face.mIndices[2]);
-			vertexBuffer.insert(vertexBuffer.end(), { vertex0, vertex1, vertex2 });
-		}
-	}
-
-	pipeline.vertexBuffer = static_cast<void*>(vertexBuffer.data());
-	pipeline.triangleCount = vertexBuffer.size() / 3;
+	pipeline.setMesh(*globalResource->boxWithTextureMesh);
 
 	renderer->pipeline(pipeline);
 }
 
-void glRenderLoop()
+void glRenderLoop(const float time)
 {
-	//drawModel3(glfwGetTime());
-	//testPipeLine(glfwGetTime());
+	//drawModel3(time);
+	//testPipeLine(time);
 	//drawImage();
-	renderCube(glfwGetTime());
+	renderCube(time);
 }
 
+/*
+Double buffered frame loop: frame N + 1 is drawn and upscaled as a JobSystem job while this thread presents frame N.
+The job measures itself and lets DynamicResolution pick the render scale of the next frame.
+The frame buffers have a bottom left origin so glDrawPixels reads them as they are.
+*/
 void initGL()
 {
-	const Renderer* renderer = globalResource->renderer;
+	DynamicResolution* dynamicResolution = globalResource->dynamicResolution;
+	const int width = dynamicResolution->getWidth();
+	const int height = dynamicResolution->getHeight();
 
 	glfwInit();
 
-	GLFWwindow* window = glfwCreateWindow(renderer->getWidth(), renderer->getHeight(), "SoftwareRendering", NULL, NULL);
+	GLFWwindow* window = glfwCreateWindow(width, height, "SoftwareRendering", NULL, NULL);
 	assert(window);
 	globalResource->window = window;
 	glfwMakeContextCurrent(window);
@@ -392,31 +354,46 @@ void initGL()
 	{
 		assert(false);
 	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 	static auto lastTime = std::chrono::system_clock::now();
 
+	JobSystem& jobSystem = JobSystem::get();
+	FrameBuffer presentBuffer(width, height, FrameBufferOrigin::bottomLeft);
+	FrameBuffer outputBuffer(width, height, FrameBufferOrigin::bottomLeft);
+	JobCounter rendering;
+	const auto renderFrame = [dynamicResolution, &outputBuffer](const float time) {
+		const auto start = std::chrono::steady_clock::now();
+		Renderer& renderer = dynamicResolution->getRenderer();
+		globalResource->renderer = &renderer;
+		renderer.flush();
+		glRenderLoop(time);
+		dynamicResolution->resolve(outputBuffer);
+		dynamicResolution->update(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	};
+	jobSystem.submit([renderFrame]() { renderFrame(0.0f); }, &rendering);
+
 	while (!glfwWindowShouldClose(window))
 	{
-		renderer->flush();
-		glRenderLoop();
-		const void* data = renderer->getFrameBuffer()->getData();
-		int width = renderer->getWidth();
-		int height = renderer->getHeight();
-		size_t length = width * height;
-		void* copyImageData = new unsigned char[length * 3];
-		memcpy(copyImageData, renderer->getFrameBuffer()->getData(), length * 3);
-		stbi__vertical_flip(copyImageData, width, height, 3);
-		glDrawPixels(width, height, GL_RGB, GL_UNSIGNED_BYTE, copyImageData);
-		delete[] copyImageData;
+		jobSystem.wait(rendering);
+		presentBuffer.swap(outputBuffer);
+		const float scale = dynamicResolution->getScale();
+		const float time = glfwGetTime();
+		jobSystem.submit([renderFrame, time]() { renderFrame(time); }, &rendering);
+		{
+			SR_PROFILE_SCOPE("present");
+			glDrawPixels(width, height, GL_RGB, GL_UNSIGNED_BYTE, presentBuffer.getData());
+		}
 		glfwSwapBuffers(window);
 		glfwPollEvents();
 
 		const auto now = std::chrono::system_clock::now();
 		const auto duration = now - lastTime;
 		const float seconds = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() / 1000.0f;
-		const std::string fpsStr = fmt::format("SoftwareRendering [fps {:.2f}]", 1.0f / seconds);
+		const std::string fpsStr = fmt::format("SoftwareRendering [fps {:.2f}, scale {:.0f}%]", 1.0f / seconds, scale * 100.0f);
 		glfwSetWindowTitle(window, fpsStr.c_str());
 		lastTime = now;
 	}
+	jobSystem.wait(rendering);
 }
 
 void write()
@@ -474,7 +451,8 @@ int main(int argc, char ** argv)
 	spdlog::set_level(spdlog::level::trace);
 
 	globalResource = new GlobalResource(argc, argv);
-	globalResource->renderer = new Renderer(800, 800);
+	globalResource->dynamicResolution = new DynamicResolution(800, 800, FrameBufferOrigin::bottomLeft);
+	globalResource->renderer = &globalResource->dynamicResolution->getRenderer();
 
 	//write();
 
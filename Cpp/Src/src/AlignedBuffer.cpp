@@ -0,0 +1,61 @@
+#include "AlignedBuffer.hpp"
+#include <new>
+#include <utility>
+
+AlignedBuffer::AlignedBuffer()
+{
+
+}
+
+AlignedBuffer::AlignedBuffer(const size_t size)
+{
+	reset(size);
+}
+
+AlignedBuffer::AlignedBuffer(AlignedBuffer && other) noexcept
+	:bytes(other.bytes), length(other.length)
+{
+	other.bytes = nullptr;
+	other.length = 0;
+}
+
+AlignedBuffer::~AlignedBuffer()
+{
+	reset(0);
+}
+
+AlignedBuffer & AlignedBuffer::operator=(AlignedBuffer && other) noexcept
+{
+	std::swap(bytes, other.bytes);
+	std::swap(length, other.length);
+	return *this;
+}
+
+size_t AlignedBuffer::size() const
+{
+	return length;
+}
+
+const void * AlignedBuffer::data() const
+{
+	return bytes;
+}
+
+void * AlignedBuffer::mutableData()
+{
+	return bytes;
+}
+
+void AlignedBuffer::reset(const size_t size)
+{
+	if (bytes)
+	{
+		::operator delete(bytes, std::align_val_t(alignment));
+		bytes = nullptr;
+	}
+	length = size;
+	if (size > 0)
+	{
+		bytes = static_cast<unsigned char*>(::operator new(size, std::align_val_t(alignment)));
+	}
+}
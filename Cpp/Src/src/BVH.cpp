@@ -0,0 +1,158 @@
+#include "BVH.hpp"
+#include <assert.h>
+#include <algorithm>
+
+bool BVH::Node::isLeaf() const
+{
+	return left < 0;
+}
+
+void BVH::build(const std::vector<BoundingBox>& boxes)
+{
+	nodes.clear();
+	itemBounds = boxes;
+	items.resize(boxes.size());
+	for (int i = 0; i < (int)boxes.size(); i++)
+	{
+		items[i] = i;
+	}
+	if (boxes.empty() == false)
+	{
+		nodes.reserve(boxes.size() * 2);
+		buildNode(boxes, 0, (int)boxes.size());
+	}
+}
+
+void BVH::refit(const std::vector<BoundingBox>& boxes)
+{
+	assert(boxes.size() == items.size());
+	itemBounds = boxes;
+	if (nodes.empty() == false)
+	{
+		refitNode(boxes, 0);
+	}
+}
+
+void BVH::query(const Frustum & frustum, std::vector<int>& visibleItems) const
+{
+	if (nodes.empty())
+	{
+		return;
+	}
+	int stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const int nodeIndex = stack[--stackSize];
+		const Node& node = nodes[nodeIndex];
+		const FrustumTest result = frustum.test(node.bounds);
+		if (result == FrustumTest::outside)
+		{
+			continue;
+		}
+		if (result == FrustumTest::inside)
+		{
+			collect(nodeIndex, visibleItems);
+		}
+		else if (node.isLeaf())
+		{
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				if (frustum.isVisible(itemBounds[items[i]]))
+				{
+					visibleItems.push_back(items[i]);
+				}
+			}
+		}
+		else
+		{
+			assert(stackSize + 2 <= 64);
+			stack[stackSize++] = node.right;
+			stack[stackSize++] = node.left;
+		}
+	}
+}
+
+int BVH::getItemCount() const
+{
+	return (int)items.size();
+}
+
+int BVH::getNodeCount() const
+{
+	return (int)nodes.size();
+}
+
+int BVH::buildNode(const std::vector<BoundingBox>& boxes, const int first, const int count)
+{
+	const int nodeIndex = (int)nodes.size();
+	nodes.push_back(Node());
+
+	BoundingBox bounds;
+	BoundingBox centroidBounds;
+	for (int i = first; i < first + count; i++)
+	{
+		bounds.expand(boxes[items[i]]);
+		centroidBounds.expand(boxes[items[i]].center());
+	}
+	nodes[nodeIndex].bounds = bounds;
+
+	const glm::vec3 size = centroidBounds.max - centroidBounds.min;
+	if (count <= maxLeafSize || (size.x <= 0.0f && size.y <= 0.0f && size.z <= 0.0f))
+	{
+		nodes[nodeIndex].first = first;
+		nodes[nodeIndex].count = count;
+		return nodeIndex;
+	}
+
+	const int axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+	const int middle = first + count / 2;
+	std::nth_element(items.begin() + first, items.begin() + middle, items.begin() + first + count, [&boxes, axis](const int lhs, const int rhs) {
+		return boxes[lhs].center()[axis] < boxes[rhs].center()[axis];
+	});
+
+	const int left = buildNode(boxes, first, middle - first);
+	const int right = buildNode(boxes, middle, first + count - middle);
+	nodes[nodeIndex].left = left;
+	nodes[nodeIndex].right = right;
+	return nodeIndex;
+}
+
+void BVH::refitNode(const std::vector<BoundingBox>& boxes, const int nodeIndex)
+{
+	Node& node = nodes[nodeIndex];
+	BoundingBox bounds;
+	if (node.isLeaf())
+	{
+		for (int i = node.first; i < node.first + node.count; i++)
+		{
+			bounds.expand(boxes[items[i]]);
+		}
+	}
+	else
+	{
+		refitNode(boxes, node.left);
+		refitNode(boxes, node.right);
+		bounds.expand(nodes[node.left].bounds);
+		bounds.expand(nodes[node.right].bounds);
+	}
+	nodes[nodeIndex].bounds = bounds;
+}
+
+void BVH::collect(const int nodeIndex, std::vector<int>& visibleItems) const
+{
+	const Node& node = nodes[nodeIndex];
+	if (node.isLeaf())
+	{
+		for (int i = node.first; i < node.first + node.count; i++)
+		{
+			visibleItems.push_back(items[i]);
+		}
+	}
+	else
+	{
+		collect(node.left, visibleItems);
+		collect(node.right, visibleItems);
+	}
+}
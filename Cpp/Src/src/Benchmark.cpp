@@ -0,0 +1,32 @@
+#include "Benchmark.hpp"
+
+#include "spdlog/spdlog.h"
+
+Benchmark Benchmark::run()
+{
+	Benchmark benchmark;
+	benchmark.start = std::chrono::steady_clock::now();
+	return benchmark;
+}
+
+double Benchmark::durationSec() const
+{
+	return std::chrono::duration<double>(duration()).count();
+}
+
+std::chrono::steady_clock::duration Benchmark::duration() const
+{
+	return std::chrono::steady_clock::now() - start;
+}
+
+void Benchmark::print(const std::string& tag) const
+{
+	if (tag.empty())
+	{
+		spdlog::info("Finished in {}s.", durationSec());
+	}
+	else
+	{
+		spdlog::info("[{}] Finished in {}s.", tag, durationSec());
+	}
+}
@@ -0,0 +1,47 @@
+#include "BoundingBox.hpp"
+
+bool BoundingBox::isValid() const noexcept
+{
+	return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+}
+
+glm::vec3 BoundingBox::center() const noexcept
+{
+	return (min + max) * 0.5f;
+}
+
+glm::vec3 BoundingBox::extent() const noexcept
+{
+	return (max - min) * 0.5f;
+}
+
+void BoundingBox::expand(const glm::vec3 & point) noexcept
+{
+	min = glm::min(min, point);
+	max = glm::max(max, point);
+}
+
+void BoundingBox::expand(const BoundingBox & boundingBox) noexcept
+{
+	min = glm::min(min, boundingBox.min);
+	max = glm::max(max, boundingBox.max);
+}
+
+BoundingBox BoundingBox::transform(const glm::mat4x4 & matrix) const noexcept
+{
+	if (isValid() == false)
+	{
+		return BoundingBox();
+	}
+	const glm::vec3 transformedCenter = glm::vec3(matrix * glm::vec4(center(), 1.0f));
+	const glm::vec3 halfExtent = extent();
+	glm::vec3 transformedExtent(0.0f);
+	for (int column = 0; column < 3; column++)
+	{
+		transformedExtent += glm::abs(glm::vec3(matrix[column])) * halfExtent[column];
+	}
+	BoundingBox boundingBox;
+	boundingBox.min = transformedCenter - transformedExtent;
+	boundingBox.max = transformedCenter + transformedExtent;
+	return boundingBox;
+}
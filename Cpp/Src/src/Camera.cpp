@@ -30,6 +30,11 @@ void FCamera::SetCameraSpeed(float Speed)
 	CameraSpeed = X;
 }
 
+Frustum FCamera::GetFrustum()
+{
+	return Frustum::fromMatrix(Projection * View);
+}
+
 glm::vec3 FCamera::GetPosition()
 {
 	return CameraPos;
@@ -0,0 +1,97 @@
+#include "CommandBuffer.hpp"
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+
+#include "Profiler.hpp"
+
+namespace
+{
+	/*
+	Bit pattern of a non negative float, which orders the same way as the float itself.
+	*/
+	uint32_t orderedBits(float value)
+	{
+		value = std::max(value, 0.0f);
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+}
+
+void CommandBuffer::submit(const DrawPacket & packet)
+{
+	assert(packet.pipeline.shader);
+	keys.push_back(sortKey(packet));
+	packets.push_back(packet);
+	isSorted = false;
+}
+
+void CommandBuffer::clear()
+{
+	packets.clear();
+	keys.clear();
+	order.clear();
+	shaderIds.clear();
+	textureIds.clear();
+	isSorted = true;
+}
+
+void CommandBuffer::sort()
+{
+	SR_PROFILE_SCOPE("sort");
+	order.resize(packets.size());
+	for (int i = 0; i < (int)order.size(); i++)
+	{
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [this](const int lhs, const int rhs) {
+		return keys[lhs] < keys[rhs];
+	});
+	isSorted = true;
+}
+
+int CommandBuffer::getPacketCount() const
+{
+	return (int)packets.size();
+}
+
+const DrawPacket & CommandBuffer::getSortedPacket(const int index) const
+{
+	assert(isSorted && index >= 0 && index < (int)order.size());
+	return packets[order[index]];
+}
+
+float CommandBuffer::viewDepth(const glm::mat4x4 & viewMat, const glm::vec3 & worldPoint)
+{
+	// FCamera is left handed, so view space z grows away from the camera.
+	return (viewMat * glm::vec4(worldPoint, 1.0f)).z;
+}
+
+int CommandBuffer::idOf(std::unordered_map<const void*, int>& ids, const void * key)
+{
+	const auto iterator = ids.find(key);
+	if (iterator != ids.end())
+	{
+		return iterator->second;
+	}
+	const int id = std::min((int)ids.size(), 0xFFFF);
+	ids[key] = id;
+	return id;
+}
+
+/*
+opaque:      [63] 0 | [47..62] depth, top 16 bits | [31..46] shader | [15..30] texture
+transparent: [63] 1 | [32..62] inverted depth     | [16..31] shader | [0..15] texture
+*/
+uint64_t CommandBuffer::sortKey(const DrawPacket & packet)
+{
+	const uint64_t shaderId = (uint64_t)idOf(shaderIds, packet.pipeline.shader);
+	const uint64_t textureId = (uint64_t)idOf(textureIds, packet.texture);
+	const uint32_t depthBits = orderedBits(packet.depth);
+	if (packet.queue == RenderQueue::opaque)
+	{
+		return ((uint64_t)(depthBits >> 16) << 47) | (shaderId << 31) | (textureId << 15);
+	}
+	return (1ull << 63) | ((uint64_t)(~depthBits >> 1) << 32) | (shaderId << 16) | textureId;
+}
@@ -0,0 +1,95 @@
+#include "DebugBuffers.hpp"
+#include <assert.h>
+#include <algorithm>
+
+DebugBuffers::DebugBuffers(int width, int height)
+	:width(width), height(height)
+{
+	assert(width >= 0 && height >= 0);
+	tileCountX = (width + tileSize - 1) / tileSize;
+	tileCountY = (height + tileSize - 1) / tileSize;
+	overdraw.resize(width * height, 0);
+	fragmentsShaded.resize(width * height, 0);
+	tileTriangles.resize(tileCountX * tileCountY, 0);
+	tileStamps.resize(tileCountX * tileCountY, 0);
+}
+
+int DebugBuffers::getWidth() const
+{
+	return width;
+}
+
+int DebugBuffers::getHeight() const
+{
+	return height;
+}
+
+void DebugBuffers::clear()
+{
+	std::fill(overdraw.begin(), overdraw.end(), 0);
+	std::fill(fragmentsShaded.begin(), fragmentsShaded.end(), 0);
+	std::fill(tileTriangles.begin(), tileTriangles.end(), 0);
+	std::fill(tileStamps.begin(), tileStamps.end(), 0);
+	triangleStamp = 0;
+}
+
+void DebugBuffers::beginTriangle()
+{
+	triangleStamp++;
+}
+
+void DebugBuffers::addDepthTest(const glm::ivec2 index)
+{
+	overdraw[index.y * width + index.x]++;
+}
+
+void DebugBuffers::addFragmentShaded(const glm::ivec2 index)
+{
+	fragmentsShaded[index.y * width + index.x]++;
+}
+
+void DebugBuffers::addTriangleCoverage(const glm::ivec2 index)
+{
+	const int tileIndex = (index.y / tileSize) * tileCountX + index.x / tileSize;
+	if (tileStamps[tileIndex] != triangleStamp)
+	{
+		tileStamps[tileIndex] = triangleStamp;
+		tileTriangles[tileIndex]++;
+	}
+}
+
+unsigned int DebugBuffers::getValue(const DebugBufferType type, const glm::ivec2 index) const
+{
+	switch (type)
+	{
+	case DebugBufferType::overdraw:
+		return overdraw[index.y * width + index.x];
+	case DebugBufferType::fragmentsShaded:
+		return fragmentsShaded[index.y * width + index.x];
+	case DebugBufferType::tileTriangles:
+		return tileTriangles[(index.y / tileSize) * tileCountX + index.x / tileSize];
+	}
+	return 0;
+}
+
+unsigned int DebugBuffers::getMaxValue(const DebugBufferType type) const
+{
+	const std::vector<unsigned int>* values = nullptr;
+	switch (type)
+	{
+	case DebugBufferType::overdraw:
+		values = &overdraw;
+		break;
+	case DebugBufferType::fragmentsShaded:
+		values = &fragmentsShaded;
+		break;
+	case DebugBufferType::tileTriangles:
+		values = &tileTriangles;
+		break;
+	}
+	if (values == nullptr || values->empty())
+	{
+		return 0;
+	}
+	return *std::max_element(values->begin(), values->end());
+}
@@ -0,0 +1,44 @@
+#include "DepthStencilState.hpp"
+
+DepthStencilState DepthStencilState::stencilMask(const unsigned char reference) noexcept
+{
+	DepthStencilState state;
+	state.isDepthWriteEnabled = false;
+	state.isStencilEnabled = true;
+	state.stencilReference = reference;
+	state.passOp = StencilOp::replace;
+	return state;
+}
+
+DepthStencilState DepthStencilState::stencilEqual(const unsigned char reference) noexcept
+{
+	DepthStencilState state;
+	state.isStencilEnabled = true;
+	state.stencilCompare = CompareOp::equal;
+	state.stencilReference = reference;
+	return state;
+}
+
+unsigned char applyStencilOp(const StencilOp op, const unsigned char value, const unsigned char reference) noexcept
+{
+	switch (op)
+	{
+	case StencilOp::keep:
+		return value;
+	case StencilOp::zero:
+		return 0;
+	case StencilOp::replace:
+		return reference;
+	case StencilOp::incrementClamp:
+		return value == 0xff ? value : value + 1;
+	case StencilOp::decrementClamp:
+		return value == 0 ? value : value - 1;
+	case StencilOp::invert:
+		return ~value;
+	case StencilOp::incrementWrap:
+		return value + 1;
+	case StencilOp::decrementWrap:
+		return value - 1;
+	}
+	return value;
+}
@@ -0,0 +1,199 @@
+#include "DynamicResolution.hpp"
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+
+namespace
+{
+	struct Tap
+	{
+		int first = 0;
+		int second = 0;
+		float weight = 0.0f;
+	};
+
+	/*
+	Source pixels around the centre of target pixel index, with the weight of the second one.
+	*/
+	Tap tapAt(const int index, const int sourceSize, const int targetSize)
+	{
+		const float position = std::clamp(((float)index + 0.5f) * sourceSize / targetSize - 0.5f, 0.0f, (float)(sourceSize - 1));
+		Tap tap;
+		tap.first = (int)position;
+		tap.second = std::min(tap.first + 1, sourceSize - 1);
+		tap.weight = position - tap.first;
+		return tap;
+	}
+
+	float luma(const unsigned char* pixel)
+	{
+		return 0.299f * pixel[0] + 0.587f * pixel[1] + 0.114f * pixel[2];
+	}
+}
+
+void upscale(const FrameBuffer & source, FrameBuffer & target, const UpscaleFilter filter)
+{
+	SR_PROFILE_SCOPE("upscale");
+	assert(source.getOrigin() == target.getOrigin());
+	if (source.getWidth() == target.getWidth() && source.getHeight() == target.getHeight())
+	{
+		target.copyDataFrom(source);
+		return;
+	}
+
+	const int sourceWidth = source.getWidth();
+	const int sourceHeight = source.getHeight();
+	const int width = target.getWidth();
+	const int height = target.getHeight();
+	const auto scaleRows = [&](int first, int last) {
+		for (int y = first; y < last; y++)
+		{
+			const Tap row = tapAt(y, sourceHeight, height);
+			const unsigned char* top = source.getData() + (size_t)row.first * source.getPitch() * 3;
+			const unsigned char* bottom = source.getData() + (size_t)row.second * source.getPitch() * 3;
+			unsigned char* out = target.mutableData() + (size_t)y * target.getPitch() * 3;
+			for (int x = 0; x < width; x++)
+			{
+				const Tap column = tapAt(x, sourceWidth, width);
+				const unsigned char* taps[4] = { top + column.first * 3, top + column.second * 3, bottom + column.first * 3, bottom + column.second * 3 };
+				float weights[4] = {
+					(1.0f - column.weight) * (1.0f - row.weight),
+					column.weight * (1.0f - row.weight),
+					(1.0f - column.weight) * row.weight,
+					column.weight * row.weight
+				};
+				if (filter == UpscaleFilter::edgeAware)
+				{
+					// Taps unlike the nearest one lose weight: a tap 64 luma levels away counts a fifth as much.
+					const int nearest = (column.weight < 0.5f ? 0 : 1) + (row.weight < 0.5f ? 0 : 2);
+					const float nearestLuma = luma(taps[nearest]);
+					float sum = 0.0f;
+					for (int i = 0; i < 4; i++)
+					{
+						weights[i] /= 1.0f + std::abs(luma(taps[i]) - nearestLuma) * (1.0f / 16.0f);
+						sum += weights[i];
+					}
+					for (int i = 0; i < 4; i++)
+					{
+						weights[i] /= sum;
+					}
+				}
+				for (int channel = 0; channel < 3; channel++)
+				{
+					const float value = weights[0] * taps[0][channel] + weights[1] * taps[1][channel]
+						+ weights[2] * taps[2][channel] + weights[3] * taps[3][channel];
+					out[x * 3 + channel] = (unsigned char)std::min(value + 0.5f, 255.0f);
+				}
+			}
+		}
+	};
+	JobSystem::get().parallelFor(height, FrameBuffer::clearRowsPerJob, std::ref(scaleRows));
+}
+
+DynamicResolution::DynamicResolution(int width, int height, const FrameBufferOrigin origin, const float minScale)
+	:storage(width, height, origin), minScale(minScale), views(levelCount, nullptr), renderers(levelCount, nullptr)
+{
+	assert(minScale > 0.0f && minScale <= 1.0f);
+}
+
+DynamicResolution::~DynamicResolution()
+{
+	for (int i = 0; i < levelCount; i++)
+	{
+		delete renderers[i];
+		delete views[i];
+	}
+}
+
+int DynamicResolution::getWidth() const
+{
+	return storage.getWidth();
+}
+
+int DynamicResolution::getHeight() const
+{
+	return storage.getHeight();
+}
+
+float DynamicResolution::getScale() const
+{
+	return levelScale(level);
+}
+
+Renderer & DynamicResolution::getRenderer()
+{
+	if (renderers[level] == nullptr)
+	{
+		const float scale = levelScale(level);
+		PixelRect rect;
+		rect.width = std::max(1, (int)std::lround(storage.getWidth() * scale));
+		rect.height = std::max(1, (int)std::lround(storage.getHeight() * scale));
+		views[level] = new FrameBuffer(storage, rect);
+		renderers[level] = new Renderer(*views[level]);
+	}
+	return *renderers[level];
+}
+
+void DynamicResolution::resolve(FrameBuffer & output) const
+{
+	assert(output.getWidth() == storage.getWidth() && output.getHeight() == storage.getHeight());
+	assert(renderers[level]);
+	upscale(*views[level], output, filter);
+}
+
+void DynamicResolution::update(const double frameMs)
+{
+	smoothedFrameMs = measuredFrames == 0 ? frameMs : smoothedFrameMs + (frameMs - smoothedFrameMs) * 0.25;
+	measuredFrames++;
+	if (isLocked || measuredFrames < settleFrames)
+	{
+		return;
+	}
+
+	int nextLevel = level;
+	if (smoothedFrameMs > targetFrameMs)
+	{
+		// Raster and shading cost follows the pixel count, i.e. the square of the scale.
+		const float scale = getScale() * (float)std::sqrt(targetFrameMs / smoothedFrameMs);
+		nextLevel = std::min(level - 1, nearestLevel(scale));
+	}
+	else if (smoothedFrameMs < targetFrameMs * raiseThreshold)
+	{
+		nextLevel = level + 1;
+	}
+	nextLevel = std::clamp(nextLevel, 0, levelCount - 1);
+	if (nextLevel != level)
+	{
+		level = nextLevel;
+		measuredFrames = 0;
+	}
+}
+
+void DynamicResolution::lockScale(const float scale)
+{
+	isLocked = scale >= 0.0f;
+	if (isLocked)
+	{
+		level = nearestLevel(scale);
+	}
+	measuredFrames = 0;
+}
+
+float DynamicResolution::levelScale(const int level) const
+{
+	return minScale + (1.0f - minScale) * level / (levelCount - 1);
+}
+
+int DynamicResolution::nearestLevel(const float scale) const
+{
+	if (minScale >= 1.0f)
+	{
+		return levelCount - 1;
+	}
+	const int nearest = (int)std::lround((scale - minScale) / (1.0f - minScale) * (levelCount - 1));
+	return std::clamp(nearest, 0, levelCount - 1);
+}
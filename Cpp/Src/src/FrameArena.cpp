@@ -0,0 +1,199 @@
+#include "FrameArena.hpp"
+#include <assert.h>
+#include <algorithm>
+
+#include "JobSystem.hpp"
+
+namespace
+{
+	thread_local LinearArena* currentArena = nullptr;
+}
+
+LinearArena::LinearArena(const size_t blockSize, const size_t retainLimit)
+	:blockSize(blockSize), retainLimit(retainLimit)
+{
+	assert(blockSize > 0 && retainLimit >= blockSize);
+}
+
+LinearArena::Scope::Scope(LinearArena & arena)
+	:previous(currentArena)
+{
+	currentArena = &arena;
+}
+
+LinearArena::Scope::~Scope()
+{
+	currentArena = previous;
+}
+
+void * LinearArena::allocate(const size_t size, const size_t alignment)
+{
+	assert(alignment > 0 && alignment <= AlignedBuffer::alignment && (alignment & (alignment - 1)) == 0);
+	size_t start = (offset + alignment - 1) & ~(alignment - 1);
+	if (blocks.empty() || start + size > blocks[currentBlock].size())
+	{
+		// Move on to the next kept block that fits, or open a new one. The tail of the current block is abandoned
+		// and not counted as used. Blocks start aligned to AlignedBuffer::alignment, so they need no padding.
+		size_t next = blocks.empty() ? 0 : currentBlock + 1;
+		while (next < blocks.size() && blocks[next].size() < size)
+		{
+			next++;
+		}
+		if (next == blocks.size())
+		{
+			blocks.emplace_back(std::max(blockSize, size));
+			statistics.reservedBytes += blocks.back().size();
+			statistics.blockAllocations++;
+		}
+		currentBlock = next;
+		offset = 0;
+		start = 0;
+	}
+	statistics.usedBytes += start + size - offset;
+	statistics.highWaterBytes = std::max(statistics.highWaterBytes, statistics.usedBytes);
+	framePeakBytes = std::max(framePeakBytes, statistics.usedBytes);
+	offset = start + size;
+	return static_cast<unsigned char*>(blocks[currentBlock].mutableData()) + start;
+}
+
+void LinearArena::pushMarker()
+{
+	assert(markerCount < maxMarkerCount);
+	Marker& marker = markers[markerCount++];
+	marker.block = currentBlock;
+	marker.offset = offset;
+	marker.usedBytes = statistics.usedBytes;
+}
+
+void LinearArena::popMarker()
+{
+	const Marker marker = markerCount > 0 ? markers[--markerCount] : Marker();
+	currentBlock = marker.block;
+	offset = marker.offset;
+	statistics.usedBytes = marker.usedBytes;
+}
+
+void LinearArena::reset()
+{
+	assert(markerCount == 0);
+	if (blocks.size() > 1 || (blocks.empty() == false && blocks[0].size() > retainLimit))
+	{
+		const size_t merged = std::min(std::max(blockSize, framePeakBytes), retainLimit);
+		if (blocks[0].size() == merged)
+		{
+			blocks.erase(blocks.begin() + 1, blocks.end());
+		}
+		else
+		{
+			blocks.clear();
+			blocks.emplace_back(merged);
+			statistics.blockAllocations++;
+		}
+		statistics.reservedBytes = merged;
+	}
+	currentBlock = 0;
+	offset = 0;
+	framePeakBytes = 0;
+	statistics.usedBytes = 0;
+}
+
+const ArenaStatistics & LinearArena::getStatistics() const
+{
+	return statistics;
+}
+
+LinearArena * LinearArena::current()
+{
+	return currentArena;
+}
+
+FrameArena::FrameArena()
+{
+	const int count = JobSystem::get().getWorkerCount();
+	for (int i = 0; i < count; i++)
+	{
+		arenas.push_back(new LinearArena());
+	}
+}
+
+FrameArena::~FrameArena()
+{
+	for (LinearArena* arena : arenas)
+	{
+		delete arena;
+	}
+	for (const std::pair<std::thread::id, LinearArena*>& foreignArena : foreignArenas)
+	{
+		delete foreignArena.second;
+	}
+}
+
+LinearArena & FrameArena::forCurrentThread()
+{
+	const int index = JobSystem::get().currentWorkerIndex();
+	if (index >= 0)
+	{
+		return *arenas[index];
+	}
+
+	const std::thread::id threadId = std::this_thread::get_id();
+	std::lock_guard<std::mutex> lock(foreignMutex);
+	for (const std::pair<std::thread::id, LinearArena*>& foreignArena : foreignArenas)
+	{
+		if (foreignArena.first == threadId)
+		{
+			return *foreignArena.second;
+		}
+	}
+	foreignArenas.emplace_back(threadId, new LinearArena());
+	return *foreignArenas.back().second;
+}
+
+template<typename Function>
+void FrameArena::forEachArena(const Function & function) const
+{
+	for (LinearArena* arena : arenas)
+	{
+		function(arena);
+	}
+	std::lock_guard<std::mutex> lock(foreignMutex);
+	for (const std::pair<std::thread::id, LinearArena*>& foreignArena : foreignArenas)
+	{
+		function(foreignArena.second);
+	}
+}
+
+FrameArena::TransientScope::TransientScope(FrameArena & frameArena)
+	:frameArena(frameArena)
+{
+	frameArena.forEachArena([](LinearArena* arena) {
+		arena->pushMarker();
+	});
+}
+
+FrameArena::TransientScope::~TransientScope()
+{
+	frameArena.forEachArena([](LinearArena* arena) {
+		arena->popMarker();
+	});
+}
+
+void FrameArena::reset()
+{
+	forEachArena([](LinearArena* arena) {
+		arena->reset();
+	});
+}
+
+ArenaStatistics FrameArena::getStatistics() const
+{
+	ArenaStatistics total;
+	forEachArena([&total](const LinearArena* arena) {
+		const ArenaStatistics& statistics = arena->getStatistics();
+		total.usedBytes += statistics.usedBytes;
+		total.highWaterBytes += statistics.highWaterBytes;
+		total.reservedBytes += statistics.reservedBytes;
+		total.blockAllocations += statistics.blockAllocations;
+	});
+	return total;
+}
@@ -1,26 +1,63 @@
 #include "FrameBuffer.hpp"
 #include <assert.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
 
 #include "spdlog/spdlog.h"
 
 #include "Util.hpp"
+#include "JobSystem.hpp"
 
-FrameBuffer::FrameBuffer(int width, int height)
-	:width(width), height(height)
+FrameBuffer::FrameBuffer(int width, int height, const FrameBufferOrigin origin)
+	:width(width), height(height), pitch(width), origin(origin)
 {
 	assert(width >= 0 && height >= 0);
 	int length = width * height;
 	data = new unsigned char[length * 3];
 	zBuffer = new double[length];
+	stencilBuffer = new unsigned char[length];
 
 	std::fill_n(zBuffer, length, 1.0);
+	std::fill_n(stencilBuffer, length, (unsigned char)0);
 	std::fill_n(data, length * 3, (unsigned char)0);
 }
 
+FrameBuffer::FrameBuffer(int width, int height, unsigned char * colorData, const FrameBufferOrigin origin)
+	:width(width), height(height), pitch(width), origin(origin), ownsColor(false), data(colorData)
+{
+	assert(width >= 0 && height >= 0 && colorData);
+	int length = width * height;
+	zBuffer = new double[length];
+	stencilBuffer = new unsigned char[length];
+
+	std::fill_n(zBuffer, length, 1.0);
+	std::fill_n(stencilBuffer, length, (unsigned char)0);
+	std::fill_n(data, length * 3, (unsigned char)0);
+}
+
+FrameBuffer::FrameBuffer(FrameBuffer & parent, const PixelRect & rect)
+	:width(rect.width), height(rect.height), pitch(parent.pitch), origin(parent.origin), isOwner(false)
+{
+	assert(rect.isEmpty() == false);
+	assert(rect.x >= 0 && rect.y >= 0 && rect.x + rect.width <= parent.width && rect.y + rect.height <= parent.height);
+	const size_t offset = (size_t)rect.y * parent.pitch + rect.x;
+	data = parent.data + offset * 3;
+	zBuffer = parent.zBuffer + offset;
+	stencilBuffer = parent.stencilBuffer + offset;
+}
+
 FrameBuffer::~FrameBuffer()
 {
-	delete[] data;
-	delete[] zBuffer;
+	if (isOwner)
+	{
+		if (ownsColor)
+		{
+			delete[] data;
+		}
+		delete[] zBuffer;
+		delete[] stencilBuffer;
+	}
 }
 
 int FrameBuffer::getWidth() const
@@ -33,6 +70,37 @@ int FrameBuffer::getHeight() const
 	return height;
 }
 
+FrameBufferOrigin FrameBuffer::getOrigin() const
+{
+	return origin;
+}
+
+int FrameBuffer::getPitch() const
+{
+	return pitch;
+}
+
+bool FrameBuffer::isView() const
+{
+	return isOwner == false;
+}
+
+bool FrameBuffer::ownsAllData() const
+{
+	return isOwner && ownsColor;
+}
+
+const unsigned char * FrameBuffer::getTopRow() const
+{
+	return origin == FrameBufferOrigin::bottomLeft && height > 0 ? data + (size_t)(height - 1) * pitch * 3 : data;
+}
+
+ptrdiff_t FrameBuffer::getRowStep() const
+{
+	const ptrdiff_t rowBytes = (ptrdiff_t)pitch * 3;
+	return origin == FrameBufferOrigin::bottomLeft ? -rowBytes : rowBytes;
+}
+
 glm::ivec2 FrameBuffer::ndcPointToPixelIndex(const glm::vec2 point) const
 {
 	const double min = -1.0;
@@ -42,15 +110,17 @@ glm::ivec2 FrameBuffer::ndcPointToPixelIndex(const glm::vec2 point) const
 	assert(point.y >= min && point.y <= max);
 	int x = (point.x - min) / d * (double)(width - 1);
 	int y = (point.y - min) / d * (double)(height - 1);
-	y = height - 1 - y;
+	if (origin == FrameBufferOrigin::topLeft)
+	{
+		y = height - 1 - y;
+	}
 	return glm::ivec2(x, y);
 }
 
 int FrameBuffer::pixelIndexToBufferIndex(const glm::ivec2 index) const
 {
-	int bufferIndex = index.y * height + index.x;
-	assert(bufferIndex >= 0 && bufferIndex < width * height);
-	return index.y * height + index.x;
+	assert(index.x >= 0 && index.x < width && index.y >= 0 && index.y < height);
+	return index.y * pitch + index.x;
 }
 
 int FrameBuffer::ndcPointToBufferIndex(const glm::vec2 point) const
@@ -60,6 +130,38 @@ int FrameBuffer::ndcPointToBufferIndex(const glm::vec2 point) const
 	return bufferIndex;
 }
 
+Rect FrameBuffer::pixelRectToNdc(const PixelRect & rect) const
+{
+	// Inverse of ndcPointToPixelIndex: pixel i covers [i, i + 1) * 2 / (size - 1) - 1.
+	const double xScale = 2.0 / (double)(width - 1);
+	const double yScale = 2.0 / (double)(height - 1);
+	const int bottom = origin == FrameBufferOrigin::topLeft ? height - rect.y - rect.height : rect.y;
+	Rect ndc;
+	ndc.x = rect.x * xScale - 1.0;
+	ndc.y = bottom * yScale - 1.0;
+	ndc.width = rect.width * xScale;
+	ndc.height = rect.height * yScale;
+	return ndc;
+}
+
+PixelRect FrameBuffer::ndcRectToPixels(const Rect & ndc) const
+{
+	if (ndc.x > 1.0 || ndc.y > 1.0 || ndc.x + ndc.width < -1.0 || ndc.y + ndc.height < -1.0)
+	{
+		return PixelRect();
+	}
+	const int left = (std::max(ndc.x, -1.0) + 1.0) / 2.0 * (double)(width - 1);
+	const int right = (std::min(ndc.x + ndc.width, 1.0) + 1.0) / 2.0 * (double)(width - 1);
+	const int bottom = (std::max(ndc.y, -1.0) + 1.0) / 2.0 * (double)(height - 1);
+	const int top = (std::min(ndc.y + ndc.height, 1.0) + 1.0) / 2.0 * (double)(height - 1);
+	PixelRect rect;
+	rect.x = left;
+	rect.y = origin == FrameBufferOrigin::topLeft ? height - 1 - top : bottom;
+	rect.width = right - left + 1;
+	rect.height = top - bottom + 1;
+	return rect;
+}
+
 glm::vec3 FrameBuffer::getPixel(const glm::vec2 point) const
 {
 	int bufferIndex = ndcPointToBufferIndex(point);
@@ -69,15 +171,18 @@ glm::vec3 FrameBuffer::getPixel(const glm::vec2 point) const
 
 void FrameBuffer::setPixel(const glm::vec2 point, const glm::vec3 color)
 {
-	const glm::ivec2 index = ndcPointToPixelIndex(point);
-	const int bufferIndex = pixelIndexToBufferIndex(index);
+	setPixel(ndcPointToBufferIndex(point), color);
+}
+
+void FrameBuffer::setPixel(const int bufferIndex, const glm::vec3 color)
+{
 	int start = bufferIndex * 3;
 	data[start] = color.r * 255.0;
 	data[start + 1] = color.g * 255.0;
 	data[start + 2] = color.b * 255.0;
 }
 
-void FrameBuffer::setPixel(const glm::vec3 point, const glm::vec3 color, const std::function<bool(double, double)> depthFunc)
+void FrameBuffer::setPixel(const glm::vec3 point, const glm::vec3 color, const DepthFunc::closure depthFunc)
 {
 	const double zValue = zValueAtNdcPoint(point);
 	const bool isPass = depthFunc(point.z, zValue);
@@ -95,20 +200,89 @@ double FrameBuffer::zValueAtNdcPoint(const glm::vec3 point) const
 
 void FrameBuffer::flush()
 {
-	const int length = width * height;
-	std::fill_n(zBuffer, length, 1.0);
-	std::fill_n(data, length * 3, (unsigned char)0);
+	JobSystem::get().parallelFor(height, clearRowsPerJob, [this](int first, int last) {
+		if (pitch == width)
+		{
+			const size_t begin = (size_t)first * width;
+			const size_t length = (size_t)(last - first) * width;
+			std::fill_n(zBuffer + begin, length, 1.0);
+			std::fill_n(stencilBuffer + begin, length, (unsigned char)0);
+			std::fill_n(data + begin * 3, length * 3, (unsigned char)0);
+			return;
+		}
+		for (int y = first; y < last; y++)
+		{
+			const size_t begin = (size_t)y * pitch;
+			std::fill_n(zBuffer + begin, width, 1.0);
+			std::fill_n(stencilBuffer + begin, width, (unsigned char)0);
+			std::fill_n(data + begin * 3, width * 3, (unsigned char)0);
+		}
+	});
+}
+
+void FrameBuffer::flush(const TileMask & tiles, const glm::vec3 color)
+{
+	assert(tiles.getWidth() == width && tiles.getHeight() == height);
+	const unsigned char r = (unsigned char)(color.r * 255.0);
+	const unsigned char g = (unsigned char)(color.g * 255.0);
+	const unsigned char b = (unsigned char)(color.b * 255.0);
+	const auto flushRows = [this, &tiles, r, g, b](int first, int last) {
+		for (int row = first; row < last; row++)
+		{
+			for (int column = 0; column < tiles.getColumns(); column++)
+			{
+				if (tiles.isSet(column, row) == false)
+				{
+					continue;
+				}
+				const PixelRect rect = tiles.getTileRect(column, row);
+				for (int y = rect.y; y < rect.y + rect.height; y++)
+				{
+					const size_t begin = (size_t)y * pitch + rect.x;
+					std::fill_n(zBuffer + begin, rect.width, 1.0);
+					std::fill_n(stencilBuffer + begin, rect.width, (unsigned char)0);
+					unsigned char* pixel = data + begin * 3;
+					for (int x = 0; x < rect.width; x++)
+					{
+						pixel[x * 3] = r;
+						pixel[x * 3 + 1] = g;
+						pixel[x * 3 + 2] = b;
+					}
+				}
+			}
+		}
+	};
+	// One job per row of tiles.
+	JobSystem::get().parallelFor(tiles.getRows(), 1, std::ref(flushRows));
 }
 
 void FrameBuffer::clear(const glm::vec3 color)
 {
-	const int length = width * height;
-	for (int i = 0; i < length; i++)
-	{
-		data[i * 3] = (unsigned char)(color.r * 255.0);
-		data[i * 3 + 1] = (unsigned char)(color.g * 255.0);
-		data[i * 3 + 2] = (unsigned char)(color.b * 255.0);
-	}
+	const unsigned char r = (unsigned char)(color.r * 255.0);
+	const unsigned char g = (unsigned char)(color.g * 255.0);
+	const unsigned char b = (unsigned char)(color.b * 255.0);
+	JobSystem::get().parallelFor(height, clearRowsPerJob, [this, r, g, b](int first, int last) {
+		for (int y = first; y < last; y++)
+		{
+			unsigned char* row = data + (size_t)y * pitch * 3;
+			for (int x = 0; x < width; x++)
+			{
+				row[x * 3] = r;
+				row[x * 3 + 1] = g;
+				row[x * 3 + 2] = b;
+			}
+		}
+	});
+}
+
+void FrameBuffer::clearStencil(const unsigned char value)
+{
+	JobSystem::get().parallelFor(height, clearRowsPerJob, [this, value](int first, int last) {
+		for (int y = first; y < last; y++)
+		{
+			std::fill_n(stencilBuffer + (size_t)y * pitch, width, value);
+		}
+	});
 }
 
 double const * const FrameBuffer::getZBuffer() const
@@ -121,6 +295,11 @@ unsigned char const * const FrameBuffer::getData() const
 	return data;
 }
 
+unsigned char const * const FrameBuffer::getStencilBuffer() const
+{
+	return stencilBuffer;
+}
+
 double * FrameBuffer::mutableZBuffer()
 {
 	return zBuffer;
@@ -130,3 +309,42 @@ unsigned char * FrameBuffer::mutableData()
 {
 	return data;
 }
+
+void FrameBuffer::setColorData(unsigned char * colorData)
+{
+	assert(isOwner && ownsColor == false && colorData);
+	data = colorData;
+}
+
+unsigned char * FrameBuffer::mutableStencilBuffer()
+{
+	return stencilBuffer;
+}
+
+void FrameBuffer::swap(FrameBuffer & other)
+{
+	std::swap(width, other.width);
+	std::swap(height, other.height);
+	std::swap(pitch, other.pitch);
+	std::swap(origin, other.origin);
+	std::swap(isOwner, other.isOwner);
+	std::swap(ownsColor, other.ownsColor);
+	std::swap(data, other.data);
+	std::swap(zBuffer, other.zBuffer);
+	std::swap(stencilBuffer, other.stencilBuffer);
+}
+
+void FrameBuffer::copyDataFrom(const FrameBuffer & other)
+{
+	assert(width == other.width && height == other.height);
+	assert(origin == other.origin);
+	if (pitch == width && other.pitch == other.width)
+	{
+		memcpy(data, other.data, (size_t)width * height * 3);
+		return;
+	}
+	for (int y = 0; y < height; y++)
+	{
+		memcpy(data + (size_t)y * pitch * 3, other.data + (size_t)y * other.pitch * 3, (size_t)width * 3);
+	}
+}
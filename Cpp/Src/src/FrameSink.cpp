@@ -0,0 +1,127 @@
+#include "FrameSink.hpp"
+#include <assert.h>
+#include <stdio.h>
+
+#include "spdlog/spdlog.h"
+
+#include "PPM.hpp"
+#include "QOI.hpp"
+#include "PNG.hpp"
+#include "Profiler.hpp"
+
+FrameSink::FrameSink(int width, int height, const FrameBufferOrigin origin, int capacity)
+{
+	assert(capacity > 0);
+	for (int i = 0; i < capacity; i++)
+	{
+		Slot slot;
+		slot.frameBuffer = new FrameBuffer(width, height, origin);
+		slots.push_back(slot);
+		freeSlots.push_back(i);
+	}
+}
+
+FrameSink::~FrameSink()
+{
+	wait();
+	for (Slot& slot : slots)
+	{
+		delete slot.frameBuffer;
+	}
+}
+
+void FrameSink::submit(const FrameBuffer & frameBuffer, const std::string & filename, const ImageFormat format)
+{
+	const int index = acquireSlot();
+	Slot& slot = slots[index];
+	slot.frameBuffer->copyDataFrom(frameBuffer);
+	slot.filename = filename;
+	slot.format = format;
+	enqueue(index);
+}
+
+void FrameSink::submitBySwap(FrameBuffer & frameBuffer, const std::string & filename, const ImageFormat format)
+{
+	const int index = acquireSlot();
+	Slot& slot = slots[index];
+	assert(slot.frameBuffer->getWidth() == frameBuffer.getWidth() && slot.frameBuffer->getHeight() == frameBuffer.getHeight());
+	assert(slot.frameBuffer->getOrigin() == frameBuffer.getOrigin() && slot.frameBuffer->getPitch() == frameBuffer.getPitch());
+	assert(frameBuffer.ownsAllData());
+	slot.frameBuffer->swap(frameBuffer);
+	slot.filename = filename;
+	slot.format = format;
+	enqueue(index);
+}
+
+void FrameSink::wait()
+{
+	JobSystem::get().wait(pendingFrames);
+}
+
+int FrameSink::getCapacity() const
+{
+	return (int)slots.size();
+}
+
+int FrameSink::acquireSlot()
+{
+	const auto hasFreeSlot = [this]() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return freeSlots.empty() == false;
+	};
+	while (true)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (freeSlots.empty() == false)
+			{
+				const int index = freeSlots.back();
+				freeSlots.pop_back();
+				return index;
+			}
+		}
+		// Every slot is being encoded: help with the encoding, and sleep once there is nothing left to help with.
+		JobSystem::get().waitUntil(std::ref(hasFreeSlot));
+	}
+}
+
+void FrameSink::enqueue(const int index)
+{
+	JobSystem::get().submit([this, index]() {
+		encode(slots[index]);
+		std::lock_guard<std::mutex> lock(mutex);
+		freeSlots.push_back(index);
+	}, &pendingFrames);
+}
+
+void FrameSink::encode(const Slot & slot) const
+{
+	SR_PROFILE_SCOPE("export");
+	std::vector<unsigned char> bytes;
+	switch (slot.format)
+	{
+	case ImageFormat::ppm:
+		bytes = PPM::encodePixels(*slot.frameBuffer);
+		break;
+	case ImageFormat::qoi:
+		bytes = QOI::encodePixels(*slot.frameBuffer);
+		break;
+	case ImageFormat::png:
+		bytes = PNG::encodePixels(*slot.frameBuffer);
+		break;
+	}
+	if (bytes.empty())
+	{
+		spdlog::error("FrameSink: can not encode {}", slot.filename);
+		return;
+	}
+
+	FILE* file = fopen(slot.filename.c_str(), "wb");
+	if (file == nullptr)
+	{
+		spdlog::error("FrameSink: can not open {}", slot.filename);
+		return;
+	}
+	fwrite(bytes.data(), 1, bytes.size(), file);
+	fclose(file);
+}
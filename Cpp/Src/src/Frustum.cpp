@@ -0,0 +1,55 @@
+#include "Frustum.hpp"
+
+float Plane::signedDistance(const glm::vec3 & point) const noexcept
+{
+	return glm::dot(normal, point) + distance;
+}
+
+Frustum Frustum::fromMatrix(const glm::mat4x4 & viewProjectionMat)
+{
+	const glm::mat4x4 m = glm::transpose(viewProjectionMat);
+	const glm::vec4 rows[6] = {
+		m[3] + m[0],
+		m[3] - m[0],
+		m[3] + m[1],
+		m[3] - m[1],
+		m[3] + m[2],
+		m[3] - m[2]
+	};
+
+	Frustum frustum;
+	for (int i = 0; i < 6; i++)
+	{
+		const glm::vec3 normal = glm::vec3(rows[i]);
+		const float length = glm::length(normal);
+		frustum.planes[i].normal = normal / length;
+		frustum.planes[i].distance = rows[i].w / length;
+	}
+	return frustum;
+}
+
+FrustumTest Frustum::test(const BoundingBox & boundingBox) const noexcept
+{
+	const glm::vec3 center = boundingBox.center();
+	const glm::vec3 extent = boundingBox.extent();
+	FrustumTest result = FrustumTest::inside;
+	for (const Plane& plane : planes)
+	{
+		const float distance = plane.signedDistance(center);
+		const float radius = glm::dot(glm::abs(plane.normal), extent);
+		if (distance < -radius)
+		{
+			return FrustumTest::outside;
+		}
+		if (distance < radius)
+		{
+			result = FrustumTest::intersect;
+		}
+	}
+	return result;
+}
+
+bool Frustum::isVisible(const BoundingBox & boundingBox) const noexcept
+{
+	return test(boundingBox) != FrustumTest::outside;
+}
@@ -0,0 +1,373 @@
+#include "JobSystem.hpp"
+#include <assert.h>
+#include <algorithm>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "spdlog/spdlog.h"
+
+namespace
+{
+	thread_local const JobSystem* currentJobSystem = nullptr;
+	thread_local int currentWorker = -1;
+
+	int setupWorkerCount = 0;
+	bool setupIsPinned = false;
+	std::atomic<bool> isCreated{ false };
+}
+
+bool JobCounter::isDone() const
+{
+	return count.load(std::memory_order_acquire) == 0;
+}
+
+JobSystem::JobSystem(int workerCount, const bool isPinned)
+{
+	if (workerCount <= 0)
+	{
+		workerCount = (int)std::max(1u, std::thread::hardware_concurrency());
+	}
+	for (int i = 0; i < workerCount; i++)
+	{
+		workers.push_back(new Worker());
+	}
+
+	currentJobSystem = this;
+	currentWorker = 0;
+	if (isPinned)
+	{
+		pinCurrentThread(0);
+	}
+	for (int i = 1; i < workerCount; i++)
+	{
+		threads.emplace_back([this, i, isPinned]() {
+			if (isPinned)
+			{
+				pinCurrentThread(i);
+			}
+			workerLoop(i);
+		});
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		isStopping = true;
+	}
+	sleepCondition.notify_all();
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	for (Worker* worker : workers)
+	{
+		delete worker;
+	}
+	if (currentJobSystem == this)
+	{
+		currentJobSystem = nullptr;
+		currentWorker = -1;
+	}
+}
+
+JobSystem & JobSystem::get()
+{
+	static JobSystem jobSystem(setupWorkerCount, setupIsPinned);
+	isCreated = true;
+	return jobSystem;
+}
+
+void JobSystem::setup(const int workerCount, const bool isPinned)
+{
+	if (isCreated)
+	{
+		spdlog::warn("JobSystem::setup called after the job system was created, ignored");
+		return;
+	}
+	setupWorkerCount = workerCount;
+	setupIsPinned = isPinned;
+}
+
+void JobSystem::submit(const std::function<void()>& function, JobCounter * counter)
+{
+	Job job;
+	job.function = function;
+	job.counter = counter;
+	if (counter)
+	{
+		counter->count.fetch_add(1, std::memory_order_relaxed);
+	}
+	push(std::move(job));
+}
+
+void JobSystem::submitAfter(JobCounter & dependency, const std::function<void()>& function, JobCounter * counter)
+{
+	Job job;
+	job.function = function;
+	job.counter = counter;
+	if (counter)
+	{
+		counter->count.fetch_add(1, std::memory_order_relaxed);
+	}
+	{
+		std::lock_guard<std::mutex> lock(dependency.mutex);
+		if (dependency.count.load(std::memory_order_acquire) > 0)
+		{
+			dependency.continuations.push_back(std::move(job));
+			return;
+		}
+	}
+	push(std::move(job));
+}
+
+void JobSystem::parallelFor(const int count, const int grainSize, const std::function<void(int, int)>& body)
+{
+	assert(grainSize > 0);
+	if (count <= 0)
+	{
+		return;
+	}
+	if (count <= grainSize || workers.size() == 1)
+	{
+		body(0, count);
+		return;
+	}
+	JobCounter counter;
+	for (int first = grainSize; first < count; first += grainSize)
+	{
+		const int last = std::min(count, first + grainSize);
+		submit([&body, first, last]() {
+			body(first, last);
+		}, &counter);
+	}
+	body(0, grainSize);
+	wait(counter);
+}
+
+void JobSystem::wait(JobCounter & counter)
+{
+	const auto isDone = [&counter]() {
+		return counter.isDone();
+	};
+	waitUntil(std::ref(isDone));
+	// The finishing job may still hold the counter mutex; taking it once guarantees it let go before the counter is destroyed.
+	std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+void JobSystem::waitUntil(const std::function<bool()>& isDone)
+{
+	// Yields before sleeping, for the common case of a job that is about to finish.
+	const int maxSpinCount = 64;
+	int spinCount = 0;
+	while (isDone() == false)
+	{
+		if (runPendingJob())
+		{
+			spinCount = 0;
+			continue;
+		}
+		if (spinCount < maxSpinCount)
+		{
+			spinCount++;
+			std::this_thread::yield();
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		waitingCount.fetch_add(1, std::memory_order_relaxed);
+		// Pairs with the fence in notifyWaiters: either isDone sees what a finished job changed, or the job sees this waiter.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		waitCondition.wait(lock, [this, &isDone]() {
+			return pendingJobCount.load(std::memory_order_acquire) > 0 || isDone();
+		});
+		waitingCount.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
+
+bool JobSystem::runPendingJob()
+{
+	Job job;
+	if (pop(job))
+	{
+		execute(job);
+		return true;
+	}
+	return false;
+}
+
+int JobSystem::getWorkerCount() const
+{
+	return (int)workers.size();
+}
+
+int JobSystem::currentWorkerIndex() const
+{
+	return currentJobSystem == this ? currentWorker : -1;
+}
+
+bool JobSystem::JobQueue::isEmpty() const
+{
+	return count == 0;
+}
+
+void JobSystem::JobQueue::pushBack(Job && job)
+{
+	if (count == slots.size())
+	{
+		std::vector<Job> grown(std::max<size_t>(16, slots.size() * 2));
+		for (size_t i = 0; i < count; i++)
+		{
+			grown[i] = std::move(slots[(head + i) % slots.size()]);
+		}
+		slots.swap(grown);
+		head = 0;
+	}
+	slots[(head + count) % slots.size()] = std::move(job);
+	count++;
+}
+
+Job JobSystem::JobQueue::popBack()
+{
+	assert(count > 0);
+	count--;
+	return std::move(slots[(head + count) % slots.size()]);
+}
+
+Job JobSystem::JobQueue::popFront()
+{
+	assert(count > 0);
+	Job job = std::move(slots[head]);
+	head = (head + 1) % slots.size();
+	count--;
+	return job;
+}
+
+void JobSystem::push(Job job)
+{
+	int index = currentWorkerIndex();
+	if (index < 0)
+	{
+		index = (int)(nextQueue.fetch_add(1, std::memory_order_relaxed) % workers.size());
+	}
+	{
+		std::lock_guard<std::mutex> lock(workers[index]->mutex);
+		workers[index]->jobs.pushBack(std::move(job));
+	}
+	pendingJobCount.fetch_add(1, std::memory_order_release);
+	{
+		// Taken so a worker between its empty check and its wait can not miss the notification.
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	sleepCondition.notify_one();
+	notifyWaiters();
+}
+
+bool JobSystem::pop(Job & job)
+{
+	if (pendingJobCount.load(std::memory_order_acquire) == 0)
+	{
+		return false;
+	}
+	const int workerCount = (int)workers.size();
+	const int self = std::max(0, currentWorkerIndex());
+	{
+		Worker& worker = *workers[self];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if (worker.jobs.isEmpty() == false)
+		{
+			job = worker.jobs.popBack();
+			pendingJobCount.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	for (int i = 1; i < workerCount; i++)
+	{
+		Worker& victim = *workers[(self + i) % workerCount];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (victim.jobs.isEmpty() == false)
+		{
+			job = victim.jobs.popFront();
+			pendingJobCount.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::execute(Job & job)
+{
+	job.function();
+	JobCounter* counter = job.counter;
+	if (counter == nullptr)
+	{
+		notifyWaiters();
+		return;
+	}
+	std::vector<Job> ready;
+	{
+		std::lock_guard<std::mutex> lock(counter->mutex);
+		if (counter->count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			ready.swap(counter->continuations);
+		}
+	}
+	for (Job& continuation : ready)
+	{
+		push(std::move(continuation));
+	}
+	notifyWaiters();
+}
+
+void JobSystem::notifyWaiters()
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (waitingCount.load(std::memory_order_relaxed) > 0)
+	{
+		{
+			// A waiter checks its condition under the mutex, so it is either before the check or already waiting.
+			std::lock_guard<std::mutex> lock(sleepMutex);
+		}
+		waitCondition.notify_all();
+	}
+}
+
+void JobSystem::workerLoop(const int workerIndex)
+{
+	currentJobSystem = this;
+	currentWorker = workerIndex;
+	while (true)
+	{
+		if (runPendingJob())
+		{
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepCondition.wait(lock, [this]() {
+			return isStopping || pendingJobCount.load(std::memory_order_acquire) > 0;
+		});
+		if (isStopping)
+		{
+			return;
+		}
+	}
+}
+
+void JobSystem::pinCurrentThread(const int core)
+{
+	const unsigned int coreCount = std::max(1u, std::thread::hardware_concurrency());
+#if defined(_WIN32)
+	SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << (core % coreCount));
+#elif defined(__linux__)
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	CPU_SET(core % coreCount, &cpuSet);
+	pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+#endif
+}
@@ -0,0 +1,79 @@
+#include "Mesh.hpp"
+
+Mesh::Mesh(const int vertexStride, const int vertexCount, const int indexCount)
+	:vertices((size_t)vertexStride * vertexCount), indices(sizeof(unsigned int) * (size_t)indexCount),
+	vertexStride(vertexStride), vertexCount(vertexCount), indexCount(indexCount)
+{
+	assert(vertexStride > 0 && vertexCount >= 0 && indexCount % 3 == 0);
+	vertexBuffer = vertices.data();
+	indexBuffer = static_cast<const unsigned int*>(indices.data());
+}
+
+Mesh::Mesh(const void * vertexBuffer, const unsigned int * indexBuffer, const int vertexStride, const int vertexCount, const int indexCount)
+	:vertexBuffer(vertexBuffer), indexBuffer(indexBuffer),
+	vertexStride(vertexStride), vertexCount(vertexCount), indexCount(indexCount)
+{
+	assert(vertexStride > 0 && vertexCount >= 0 && indexCount % 3 == 0);
+}
+
+int Mesh::getVertexStride() const
+{
+	return vertexStride;
+}
+
+int Mesh::getVertexCount() const
+{
+	return vertexCount;
+}
+
+int Mesh::getIndexCount() const
+{
+	return indexCount;
+}
+
+int Mesh::getTriangleCount() const
+{
+	return indexCount / 3;
+}
+
+const void * Mesh::getVertexBuffer() const
+{
+	return vertexBuffer;
+}
+
+const unsigned int * Mesh::getIndexBuffer() const
+{
+	return indexBuffer;
+}
+
+void * Mesh::mutableVertexBuffer()
+{
+	assert(vertexBuffer == vertices.data());
+	return vertices.mutableData();
+}
+
+unsigned int * Mesh::mutableIndexBuffer()
+{
+	assert(indexBuffer == indices.data());
+	return static_cast<unsigned int*>(indices.mutableData());
+}
+
+const BoundingBox & Mesh::getBounds() const
+{
+	return bounds;
+}
+
+void Mesh::setBounds(const BoundingBox & bounds)
+{
+	this->bounds = bounds;
+}
+
+const std::vector<SubMesh>& Mesh::getSubMeshes() const
+{
+	return subMeshes;
+}
+
+void Mesh::setSubMeshes(const std::vector<SubMesh>& subMeshes)
+{
+	this->subMeshes = subMeshes;
+}
@@ -0,0 +1,356 @@
+#include "MeshFile.hpp"
+#include <assert.h>
+#include <string.h>
+#include <fstream>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "spdlog/spdlog.h"
+
+#include "ModelShader.hpp"
+#include "ModelShader2.hpp"
+
+namespace
+{
+	const char magic[4] = { 'S', 'R', 'M', 'F' };
+	const uint64_t sectionAlignment = 64;
+
+	struct MeshFileHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t vertexFormat;
+		uint32_t vertexStride;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t subMeshCount;
+		uint32_t materialCount;
+		float boundsMin[3];
+		float boundsMax[3];
+		uint64_t vertexOffset;
+		uint64_t indexOffset;
+		uint64_t subMeshOffset;
+		uint64_t materialOffset;
+		uint64_t stringOffset;
+		uint64_t fileSize;
+	};
+
+	struct MeshFileSubMesh
+	{
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		uint32_t materialIndex;
+		uint32_t reserved;
+	};
+
+	struct MeshFileMaterial
+	{
+		float diffuseColor[4];
+		uint32_t diffuseTextureOffset;
+		uint32_t diffuseTextureLength;
+	};
+
+	uint64_t alignOffset(const uint64_t offset)
+	{
+		return (offset + sectionAlignment - 1) / sectionAlignment * sectionAlignment;
+	}
+
+	bool isSectionInside(const uint64_t offset, const uint64_t length, const uint64_t fileSize)
+	{
+		return offset <= fileSize && length <= fileSize - offset;
+	}
+
+	/*
+	Known formats are read as their shader vertex struct, so the stride must match it; unknown formats are rejected.
+	*/
+	bool isVertexStrideValid(const uint32_t vertexFormat, const uint32_t vertexStride)
+	{
+		switch ((MeshVertexFormat)vertexFormat)
+		{
+		case MeshVertexFormat::custom:
+			return vertexStride > 0;
+		case MeshVertexFormat::baseVertex:
+			return vertexStride == sizeof(BaseVertex);
+		case MeshVertexFormat::baseVertex2:
+			return vertexStride == sizeof(BaseVertex2);
+		}
+		return false;
+	}
+}
+
+std::vector<MeshMaterial> MeshMaterial::fromScene(const aiScene * scene)
+{
+	std::vector<MeshMaterial> materials;
+	for (unsigned int i = 0; i < scene->mNumMaterials; i++)
+	{
+		const aiMaterial* sceneMaterial = scene->mMaterials[i];
+		MeshMaterial material;
+		aiColor4D diffuseColor;
+		if (sceneMaterial->Get(AI_MATKEY_COLOR_DIFFUSE, diffuseColor) == aiReturn_SUCCESS)
+		{
+			material.diffuseColor = glm::vec4(diffuseColor.r, diffuseColor.g, diffuseColor.b, diffuseColor.a);
+		}
+		aiString texturePath;
+		if (sceneMaterial->GetTextureCount(aiTextureType_DIFFUSE) > 0 && sceneMaterial->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath) == aiReturn_SUCCESS)
+		{
+			material.diffuseTexture = texturePath.C_Str();
+		}
+		materials.push_back(material);
+	}
+	return materials;
+}
+
+MeshFile::MeshFile()
+{
+
+}
+
+MeshFile::~MeshFile()
+{
+	delete mesh;
+#if defined(_WIN32)
+	if (mappedData)
+	{
+		UnmapViewOfFile(mappedData);
+	}
+	if (mappingHandle)
+	{
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle && fileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(fileHandle);
+	}
+#else
+	if (mappedData)
+	{
+		munmap(mappedData, mappedSize);
+	}
+#endif
+}
+
+bool MeshFile::write(const std::string & filename, const Mesh & mesh, const MeshVertexFormat vertexFormat, const std::vector<MeshMaterial>& materials)
+{
+	const std::vector<SubMesh>& subMeshes = mesh.getSubMeshes();
+
+	std::string strings;
+	std::vector<MeshFileMaterial> fileMaterials;
+	for (const MeshMaterial& material : materials)
+	{
+		MeshFileMaterial fileMaterial;
+		for (int i = 0; i < 4; i++)
+		{
+			fileMaterial.diffuseColor[i] = material.diffuseColor[i];
+		}
+		fileMaterial.diffuseTextureOffset = (uint32_t)strings.size();
+		fileMaterial.diffuseTextureLength = (uint32_t)material.diffuseTexture.size();
+		strings += material.diffuseTexture;
+		fileMaterials.push_back(fileMaterial);
+	}
+
+	std::vector<MeshFileSubMesh> fileSubMeshes;
+	for (const SubMesh& subMesh : subMeshes)
+	{
+		MeshFileSubMesh fileSubMesh;
+		fileSubMesh.firstIndex = subMesh.firstIndex;
+		fileSubMesh.indexCount = subMesh.indexCount;
+		fileSubMesh.materialIndex = subMesh.materialIndex;
+		fileSubMesh.reserved = 0;
+		fileSubMeshes.push_back(fileSubMesh);
+	}
+
+	const uint64_t vertexBytes = (uint64_t)mesh.getVertexStride() * mesh.getVertexCount();
+	const uint64_t indexBytes = sizeof(uint32_t) * (uint64_t)mesh.getIndexCount();
+
+	MeshFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.vertexFormat = (uint32_t)vertexFormat;
+	header.vertexStride = mesh.getVertexStride();
+	header.vertexCount = mesh.getVertexCount();
+	header.indexCount = mesh.getIndexCount();
+	header.subMeshCount = (uint32_t)fileSubMeshes.size();
+	header.materialCount = (uint32_t)fileMaterials.size();
+	for (int i = 0; i < 3; i++)
+	{
+		header.boundsMin[i] = mesh.getBounds().min[i];
+		header.boundsMax[i] = mesh.getBounds().max[i];
+	}
+	header.vertexOffset = alignOffset(sizeof(MeshFileHeader));
+	header.indexOffset = alignOffset(header.vertexOffset + vertexBytes);
+	header.subMeshOffset = alignOffset(header.indexOffset + indexBytes);
+	header.materialOffset = alignOffset(header.subMeshOffset + sizeof(MeshFileSubMesh) * fileSubMeshes.size());
+	header.stringOffset = alignOffset(header.materialOffset + sizeof(MeshFileMaterial) * fileMaterials.size());
+	header.fileSize = header.stringOffset + strings.size();
+
+	std::vector<char> bytes(header.fileSize, 0);
+	memcpy(bytes.data(), &header, sizeof(header));
+	memcpy(bytes.data() + header.vertexOffset, mesh.getVertexBuffer(), vertexBytes);
+	memcpy(bytes.data() + header.indexOffset, mesh.getIndexBuffer(), indexBytes);
+	memcpy(bytes.data() + header.subMeshOffset, fileSubMeshes.data(), sizeof(MeshFileSubMesh) * fileSubMeshes.size());
+	memcpy(bytes.data() + header.materialOffset, fileMaterials.data(), sizeof(MeshFileMaterial) * fileMaterials.size());
+	memcpy(bytes.data() + header.stringOffset, strings.data(), strings.size());
+
+	std::ofstream f(filename, std::ios::binary);
+	if (f.is_open() == false)
+	{
+		spdlog::error("MeshFile: can not open {}", filename);
+		return false;
+	}
+	f.write(bytes.data(), bytes.size());
+	return f.good();
+}
+
+MeshFile * MeshFile::open(const std::string & filename)
+{
+	MeshFile* meshFile = new MeshFile();
+
+#if defined(_WIN32)
+	meshFile->fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	LARGE_INTEGER fileSize;
+	if (meshFile->fileHandle == INVALID_HANDLE_VALUE || GetFileSizeEx(meshFile->fileHandle, &fileSize) == false)
+	{
+		spdlog::error("MeshFile: can not open {}", filename);
+		delete meshFile;
+		return nullptr;
+	}
+	meshFile->mappedSize = (size_t)fileSize.QuadPart;
+	if (meshFile->mappedSize > 0)
+	{
+		meshFile->mappingHandle = CreateFileMappingA(meshFile->fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (meshFile->mappingHandle)
+		{
+			meshFile->mappedData = MapViewOfFile(meshFile->mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		}
+	}
+#else
+	const int fd = ::open(filename.c_str(), O_RDONLY);
+	struct stat fileStat;
+	if (fd < 0 || fstat(fd, &fileStat) != 0)
+	{
+		spdlog::error("MeshFile: can not open {}", filename);
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+		delete meshFile;
+		return nullptr;
+	}
+	meshFile->mappedSize = (size_t)fileStat.st_size;
+	if (meshFile->mappedSize > 0)
+	{
+		void* data = mmap(nullptr, meshFile->mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		meshFile->mappedData = data == MAP_FAILED ? nullptr : data;
+	}
+	close(fd);
+#endif
+
+	if (meshFile->mappedData == nullptr || meshFile->mappedSize < sizeof(MeshFileHeader))
+	{
+		spdlog::error("MeshFile: can not map {}", filename);
+		delete meshFile;
+		return nullptr;
+	}
+
+	const char* bytes = static_cast<const char*>(meshFile->mappedData);
+	const MeshFileHeader* header = reinterpret_cast<const MeshFileHeader*>(bytes);
+	const uint64_t fileSize = meshFile->mappedSize;
+	const bool isValid = memcmp(header->magic, magic, sizeof(magic)) == 0
+		&& header->version == version
+		&& header->fileSize == fileSize
+		&& isVertexStrideValid(header->vertexFormat, header->vertexStride)
+		&& header->indexCount % 3 == 0
+		&& header->vertexOffset % sectionAlignment == 0
+		&& header->indexOffset % alignof(uint32_t) == 0
+		&& header->subMeshOffset % alignof(MeshFileSubMesh) == 0
+		&& header->materialOffset % alignof(MeshFileMaterial) == 0
+		&& isSectionInside(header->vertexOffset, (uint64_t)header->vertexStride * header->vertexCount, fileSize)
+		&& isSectionInside(header->indexOffset, sizeof(uint32_t) * (uint64_t)header->indexCount, fileSize)
+		&& isSectionInside(header->subMeshOffset, sizeof(MeshFileSubMesh) * (uint64_t)header->subMeshCount, fileSize)
+		&& isSectionInside(header->materialOffset, sizeof(MeshFileMaterial) * (uint64_t)header->materialCount, fileSize)
+		&& header->stringOffset <= fileSize;
+	if (isValid == false)
+	{
+		spdlog::error("MeshFile: {} is not a version {} mesh file", filename, version);
+		delete meshFile;
+		return nullptr;
+	}
+
+	// Render workers load files unattended, so everything later read through the mapping is bounds checked once here.
+	const uint32_t* indices = reinterpret_cast<const uint32_t*>(bytes + header->indexOffset);
+	const MeshFileSubMesh* fileSubMeshes = reinterpret_cast<const MeshFileSubMesh*>(bytes + header->subMeshOffset);
+	bool isInside = true;
+	for (uint32_t i = 0; i < header->indexCount; i++)
+	{
+		isInside &= indices[i] < header->vertexCount;
+	}
+	for (uint32_t i = 0; i < header->subMeshCount; i++)
+	{
+		isInside &= (uint64_t)fileSubMeshes[i].firstIndex + fileSubMeshes[i].indexCount <= header->indexCount;
+	}
+	if (isInside == false)
+	{
+		spdlog::error("MeshFile: {} has indices or sub meshes outside its buffers", filename);
+		delete meshFile;
+		return nullptr;
+	}
+
+	meshFile->vertexFormat = (MeshVertexFormat)header->vertexFormat;
+	meshFile->mesh = new Mesh(bytes + header->vertexOffset, indices,
+		header->vertexStride, header->vertexCount, header->indexCount);
+
+	BoundingBox bounds;
+	bounds.min = glm::vec3(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]);
+	bounds.max = glm::vec3(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]);
+	meshFile->mesh->setBounds(bounds);
+
+	std::vector<SubMesh> subMeshes;
+	for (uint32_t i = 0; i < header->subMeshCount; i++)
+	{
+		SubMesh subMesh;
+		subMesh.firstIndex = fileSubMeshes[i].firstIndex;
+		subMesh.indexCount = fileSubMeshes[i].indexCount;
+		subMesh.materialIndex = fileSubMeshes[i].materialIndex;
+		subMeshes.push_back(subMesh);
+	}
+	meshFile->mesh->setSubMeshes(subMeshes);
+
+	const MeshFileMaterial* fileMaterials = reinterpret_cast<const MeshFileMaterial*>(bytes + header->materialOffset);
+	const uint64_t stringLength = fileSize - header->stringOffset;
+	for (uint32_t i = 0; i < header->materialCount; i++)
+	{
+		MeshMaterial material;
+		material.diffuseColor = glm::vec4(fileMaterials[i].diffuseColor[0], fileMaterials[i].diffuseColor[1], fileMaterials[i].diffuseColor[2], fileMaterials[i].diffuseColor[3]);
+		if (isSectionInside(fileMaterials[i].diffuseTextureOffset, fileMaterials[i].diffuseTextureLength, stringLength))
+		{
+			material.diffuseTexture.assign(bytes + header->stringOffset + fileMaterials[i].diffuseTextureOffset, fileMaterials[i].diffuseTextureLength);
+		}
+		meshFile->materials.push_back(material);
+	}
+
+	return meshFile;
+}
+
+const Mesh & MeshFile::getMesh() const
+{
+	return *mesh;
+}
+
+MeshVertexFormat MeshFile::getVertexFormat() const
+{
+	return vertexFormat;
+}
+
+const std::vector<MeshMaterial>& MeshFile::getMaterials() const
+{
+	return materials;
+}
@@ -0,0 +1,354 @@
+#include "OcclusionBuffer.hpp"
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Profiler.hpp"
+
+namespace
+{
+	const float minW = 1e-5f;
+
+	/*
+	Pieces left of a pixel smaller than this, in square pixels, are rounding noise along shared edges.
+	*/
+	const float minPieceArea = 1e-6f;
+
+	/*
+	Convex polygon in pixel coordinates. Clipping a square by the lines of a few triangles stays well below the limit;
+	a piece that would exceed it is kept uncovered.
+	*/
+	struct ClipPolygon
+	{
+		static constexpr int maxPointCount = 16;
+		glm::vec2 points[maxPointCount];
+		int count = 0;
+	};
+
+	float edgeSide(const glm::vec2 a, const glm::vec2 b, const glm::vec2 p)
+	{
+		return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+	}
+
+	/*
+	Part of polygon on the left of a->b if keepLeft, otherwise on the right. Returns false if the result overflows.
+	*/
+	bool clipPolygon(const ClipPolygon& polygon, const glm::vec2 a, const glm::vec2 b, const bool keepLeft, ClipPolygon& out)
+	{
+		out.count = 0;
+		for (int i = 0; i < polygon.count; i++)
+		{
+			const glm::vec2 start = polygon.points[i];
+			const glm::vec2 end = polygon.points[(i + 1) % polygon.count];
+			const float startSide = keepLeft ? edgeSide(a, b, start) : -edgeSide(a, b, start);
+			const float endSide = keepLeft ? edgeSide(a, b, end) : -edgeSide(a, b, end);
+			if (startSide >= 0.0f)
+			{
+				if (out.count == ClipPolygon::maxPointCount)
+				{
+					return false;
+				}
+				out.points[out.count++] = start;
+			}
+			if ((startSide >= 0.0f) != (endSide >= 0.0f))
+			{
+				if (out.count == ClipPolygon::maxPointCount)
+				{
+					return false;
+				}
+				out.points[out.count++] = start + (end - start) * (startSide / (startSide - endSide));
+			}
+		}
+		return true;
+	}
+
+	float polygonArea(const ClipPolygon& polygon)
+	{
+		float area = 0.0f;
+		for (int i = 0; i < polygon.count; i++)
+		{
+			const glm::vec2 a = polygon.points[i];
+			const glm::vec2 b = polygon.points[(i + 1) % polygon.count];
+			area += a.x * b.y - b.x * a.y;
+		}
+		return std::abs(area) * 0.5f;
+	}
+}
+
+OcclusionBuffer::OcclusionBuffer(int width, int height)
+	:frameBuffer(new FrameBuffer(width, height))
+{
+	assert(width > 1 && height > 1);
+}
+
+OcclusionBuffer::~OcclusionBuffer()
+{
+	delete frameBuffer;
+}
+
+void OcclusionBuffer::begin(const glm::mat4x4 & viewProjectionMat)
+{
+	this->viewProjectionMat = viewProjectionMat;
+	const int length = frameBuffer->getWidth() * frameBuffer->getHeight();
+	std::fill_n(frameBuffer->mutableZBuffer(), length, 1.0);
+	occluderTriangleCount = 0;
+}
+
+void OcclusionBuffer::begin(FCamera & camera)
+{
+	begin(camera.GetprojectionMat() * camera.GetViewMat());
+}
+
+void OcclusionBuffer::addOccluder(const Mesh & mesh, const glm::mat4x4 & modelMat)
+{
+	SR_PROFILE_SCOPE("occluders");
+	const glm::mat4x4 mvpMat = viewProjectionMat * modelMat;
+	const char* vertices = static_cast<const char*>(mesh.getVertexBuffer());
+	const unsigned int* indices = mesh.getIndexBuffer();
+	const int stride = mesh.getVertexStride();
+	triangles.clear();
+	partialPixels.clear();
+	for (int i = 0; i < mesh.getTriangleCount(); i++)
+	{
+		glm::vec4 clip[3];
+		bool isInFront = true;
+		for (int k = 0; k < 3; k++)
+		{
+			const glm::vec3 position = *reinterpret_cast<const glm::vec3*>(vertices + (size_t)indices[3 * i + k] * stride);
+			clip[k] = mvpMat * glm::vec4(position, 1.0f);
+			isInFront = isInFront && clip[k].w > minW;
+		}
+		// Triangles crossing the camera plane are skipped rather than clipped, which only makes culling less aggressive.
+		if (isInFront == false)
+		{
+			continue;
+		}
+		rasterizeTriangle(glm::vec3(clip[0]) / clip[0].w, glm::vec3(clip[1]) / clip[1].w, glm::vec3(clip[2]) / clip[2].w);
+	}
+	resolvePartialPixels();
+}
+
+bool OcclusionBuffer::isVisible(const BoundingBox & worldBounds) const
+{
+	glm::vec3 ndcMin(std::numeric_limits<float>::max());
+	glm::vec3 ndcMax(std::numeric_limits<float>::lowest());
+	for (int i = 0; i < 8; i++)
+	{
+		const glm::vec3 corner((i & 1) ? worldBounds.max.x : worldBounds.min.x,
+			(i & 2) ? worldBounds.max.y : worldBounds.min.y,
+			(i & 4) ? worldBounds.max.z : worldBounds.min.z);
+		const glm::vec4 clip = viewProjectionMat * glm::vec4(corner, 1.0f);
+		if (clip.w <= minW)
+		{
+			return true;
+		}
+		const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		ndcMin = glm::min(ndcMin, ndc);
+		ndcMax = glm::max(ndcMax, ndc);
+	}
+	if (ndcMax.x < -1.0f || ndcMax.y < -1.0f || ndcMin.x > 1.0f || ndcMin.y > 1.0f)
+	{
+		return false;
+	}
+
+	const glm::vec2 pixelMin = ndcToPixel(glm::max(glm::vec2(ndcMin), glm::vec2(-1.0f)));
+	const glm::vec2 pixelMax = ndcToPixel(glm::min(glm::vec2(ndcMax), glm::vec2(1.0f)));
+	const int width = frameBuffer->getWidth();
+	const int height = frameBuffer->getHeight();
+	const int x0 = std::max(0, (int)std::floor(pixelMin.x));
+	const int y0 = std::max(0, (int)std::floor(pixelMin.y));
+	const int x1 = std::min(width - 1, (int)std::floor(pixelMax.x));
+	const int y1 = std::min(height - 1, (int)std::floor(pixelMax.y));
+	const double* zBuffer = frameBuffer->getZBuffer();
+	for (int y = y0; y <= y1; y++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			if (ndcMin.z <= zBuffer[bufferIndex(x, y)])
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+const FrameBuffer * OcclusionBuffer::getFrameBuffer() const
+{
+	return frameBuffer;
+}
+
+int OcclusionBuffer::getOccluderTriangleCount() const
+{
+	return occluderTriangleCount;
+}
+
+void OcclusionBuffer::rasterizeTriangle(const glm::vec3 a, const glm::vec3 b, const glm::vec3 c)
+{
+	ScreenTriangle triangle;
+	triangle.points[0] = ndcToPixel(a);
+	triangle.points[1] = ndcToPixel(b);
+	triangle.points[2] = ndcToPixel(c);
+	triangle.depths = glm::vec3(a.z, b.z, c.z);
+	const float area = edgeSide(triangle.points[0], triangle.points[1], triangle.points[2]);
+	if (std::abs(area) < 1e-12f)
+	{
+		return;
+	}
+	if (area < 0.0f)
+	{
+		std::swap(triangle.points[1], triangle.points[2]);
+		std::swap(triangle.depths[1], triangle.depths[2]);
+	}
+	occluderTriangleCount += 1;
+	const int triangleIndex = (int)triangles.size();
+	triangles.push_back(triangle);
+
+	const glm::vec2* p = triangle.points;
+	const int width = frameBuffer->getWidth();
+	const int height = frameBuffer->getHeight();
+	const int x0 = std::max(0, (int)std::floor(std::min({ p[0].x, p[1].x, p[2].x })));
+	const int y0 = std::max(0, (int)std::floor(std::min({ p[0].y, p[1].y, p[2].y })));
+	const int x1 = std::min(width - 1, (int)std::floor(std::max({ p[0].x, p[1].x, p[2].x })));
+	const int y1 = std::min(height - 1, (int)std::floor(std::max({ p[0].y, p[1].y, p[2].y })));
+	for (int y = y0; y <= y1; y++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			// Pixel (x, y) spans [x, x + 1) x [y, y + 1), as isVisible reads it. The triangle is convex, so it covers
+			// the pixel when it contains all four corners.
+			int insideCount = 0;
+			bool isOutside = false;
+			for (int edge = 0; edge < 3; edge++)
+			{
+				int leftCount = 0;
+				for (int corner = 0; corner < 4; corner++)
+				{
+					const glm::vec2 point((float)(x + (corner & 1)), (float)(y + (corner >> 1)));
+					leftCount += edgeSide(p[edge], p[(edge + 1) % 3], point) >= 0.0f;
+				}
+				insideCount += leftCount == 4;
+				isOutside = isOutside || leftCount == 0;
+			}
+			if (insideCount == 3)
+			{
+				float nearZ = 0.0f;
+				float farZ = 0.0f;
+				depthRange(triangle, x, y, nearZ, farZ);
+				writeDepth(x, y, nearZ, farZ);
+			}
+			else if (isOutside == false)
+			{
+				partialPixels.emplace_back(y * width + x, triangleIndex);
+			}
+		}
+	}
+}
+
+void OcclusionBuffer::resolvePartialPixels()
+{
+	std::sort(partialPixels.begin(), partialPixels.end());
+	const int width = frameBuffer->getWidth();
+	std::vector<ClipPolygon> pieces;
+	std::vector<ClipPolygon> remaining;
+	size_t first = 0;
+	while (first < partialPixels.size())
+	{
+		const int pixel = partialPixels[first].first;
+		size_t last = first;
+		while (last < partialPixels.size() && partialPixels[last].first == pixel)
+		{
+			last++;
+		}
+		const int x = pixel % width;
+		const int y = pixel / width;
+
+		// Cut every triangle out of the pixel square; the pixel is covered if nothing is left.
+		ClipPolygon square;
+		square.count = 4;
+		square.points[0] = glm::vec2((float)x, (float)y);
+		square.points[1] = glm::vec2((float)(x + 1), (float)y);
+		square.points[2] = glm::vec2((float)(x + 1), (float)(y + 1));
+		square.points[3] = glm::vec2((float)x, (float)(y + 1));
+		pieces.assign(1, square);
+		bool isCovered = last - first > 1;
+		float nearZ = std::numeric_limits<float>::max();
+		float farZ = std::numeric_limits<float>::lowest();
+		for (size_t i = first; i < last && isCovered && pieces.empty() == false; i++)
+		{
+			const ScreenTriangle& triangle = triangles[partialPixels[i].second];
+			float triangleNearZ = 0.0f;
+			float triangleFarZ = 0.0f;
+			depthRange(triangle, x, y, triangleNearZ, triangleFarZ);
+			nearZ = std::min(nearZ, triangleNearZ);
+			farZ = std::max(farZ, triangleFarZ);
+
+			remaining.clear();
+			for (const ClipPolygon& piece : pieces)
+			{
+				// The piece outside the triangle is what lies right of one edge and left of the edges before it.
+				ClipPolygon inside = piece;
+				for (int edge = 0; edge < 3 && inside.count >= 3 && isCovered; edge++)
+				{
+					const glm::vec2 a = triangle.points[edge];
+					const glm::vec2 b = triangle.points[(edge + 1) % 3];
+					ClipPolygon outside;
+					ClipPolygon next;
+					isCovered = clipPolygon(inside, a, b, false, outside) && clipPolygon(inside, a, b, true, next);
+					if (outside.count >= 3 && polygonArea(outside) > minPieceArea)
+					{
+						remaining.push_back(outside);
+					}
+					inside = next;
+				}
+			}
+			pieces.swap(remaining);
+		}
+		if (isCovered && pieces.empty())
+		{
+			writeDepth(x, y, nearZ, farZ);
+		}
+		first = last;
+	}
+}
+
+void OcclusionBuffer::depthRange(const ScreenTriangle & triangle, const int x, const int y, float & nearZ, float & farZ) const
+{
+	// NDC depth is affine in screen space, so the plane is nearest and farthest at pixel corners.
+	const glm::vec2* p = triangle.points;
+	const float area = edgeSide(p[0], p[1], p[2]);
+	nearZ = std::numeric_limits<float>::max();
+	farZ = std::numeric_limits<float>::lowest();
+	for (int corner = 0; corner < 4; corner++)
+	{
+		const glm::vec2 point((float)(x + (corner & 1)), (float)(y + (corner >> 1)));
+		const float w0 = edgeSide(p[1], p[2], point) / area;
+		const float w1 = edgeSide(p[2], p[0], point) / area;
+		const float w2 = 1.0f - w0 - w1;
+		const float z = w0 * triangle.depths[0] + w1 * triangle.depths[1] + w2 * triangle.depths[2];
+		nearZ = std::min(nearZ, z);
+		farZ = std::max(farZ, z);
+	}
+}
+
+void OcclusionBuffer::writeDepth(const int x, const int y, const float nearZ, const float farZ)
+{
+	double& depth = frameBuffer->mutableZBuffer()[bufferIndex(x, y)];
+	if (nearZ >= -1.0f && farZ < depth)
+	{
+		depth = farZ;
+	}
+}
+
+glm::vec2 OcclusionBuffer::ndcToPixel(const glm::vec2 point) const
+{
+	// Same mapping as FrameBuffer::ndcPointToPixelIndex before its vertical flip.
+	return glm::vec2((point.x + 1.0f) * 0.5f * (frameBuffer->getWidth() - 1),
+		(point.y + 1.0f) * 0.5f * (frameBuffer->getHeight() - 1));
+}
+
+int OcclusionBuffer::bufferIndex(const int x, const int y) const
+{
+	return frameBuffer->pixelIndexToBufferIndex(glm::ivec2(x, frameBuffer->getHeight() - 1 - y));
+}
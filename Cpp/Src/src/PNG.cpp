@@ -0,0 +1,191 @@
+#include "PNG.hpp"
+#include <string.h>
+#include <atomic>
+#include <fstream>
+#include <algorithm>
+
+#include "zlib.h"
+#include "spdlog/spdlog.h"
+
+#include "JobSystem.hpp"
+
+namespace
+{
+	struct Band
+	{
+		int firstRow = 0;
+		int rowCount = 0;
+		std::vector<unsigned char> compressed;
+		unsigned long adler = 1;
+	};
+
+	void appendUInt32(std::vector<unsigned char>& bytes, const unsigned int value)
+	{
+		bytes.push_back((unsigned char)(value >> 24));
+		bytes.push_back((unsigned char)(value >> 16));
+		bytes.push_back((unsigned char)(value >> 8));
+		bytes.push_back((unsigned char)(value));
+	}
+
+	void appendChunk(std::vector<unsigned char>& bytes, const char* type, const unsigned char* data, const size_t length)
+	{
+		appendUInt32(bytes, (unsigned int)length);
+		const size_t start = bytes.size();
+		bytes.insert(bytes.end(), type, type + 4);
+		bytes.insert(bytes.end(), data, data + length);
+		const unsigned long crc = crc32(0, bytes.data() + start, (uInt)(length + 4));
+		appendUInt32(bytes, (unsigned int)crc);
+	}
+
+	/*
+	Picks, per row, whichever of None/Sub/Up gives the smallest sum of absolute residuals.
+	*/
+	void filterRow(const unsigned char* row, const unsigned char* previousRow, const int rowLength, unsigned char* out)
+	{
+		const int bpp = 3;
+		unsigned int costNone = 0;
+		unsigned int costSub = 0;
+		unsigned int costUp = 0;
+		for (int i = 0; i < rowLength; i++)
+		{
+			const unsigned char left = i >= bpp ? row[i - bpp] : 0;
+			const unsigned char up = previousRow ? previousRow[i] : 0;
+			costNone += std::abs((signed char)row[i]);
+			costSub += std::abs((signed char)(row[i] - left));
+			costUp += std::abs((signed char)(row[i] - up));
+		}
+
+		if (costSub <= costUp && costSub <= costNone)
+		{
+			out[0] = 1;
+			for (int i = 0; i < rowLength; i++)
+			{
+				out[i + 1] = row[i] - (i >= bpp ? row[i - bpp] : 0);
+			}
+		}
+		else if (costUp <= costNone)
+		{
+			out[0] = 2;
+			for (int i = 0; i < rowLength; i++)
+			{
+				out[i + 1] = row[i] - (previousRow ? previousRow[i] : 0);
+			}
+		}
+		else
+		{
+			out[0] = 0;
+			memcpy(out + 1, row, rowLength);
+		}
+	}
+
+	/*
+	Returns false if zlib fails; band.compressed is then empty.
+	*/
+	bool compressBand(const unsigned char* topRow, const int width, const ptrdiff_t rowStep, const int compressionLevel, const bool isLast, Band& band)
+	{
+		const int rowLength = width * 3;
+		std::vector<unsigned char> filtered((size_t)(rowLength + 1) * band.rowCount);
+		for (int i = 0; i < band.rowCount; i++)
+		{
+			const int y = band.firstRow + i;
+			const unsigned char* row = topRow + y * rowStep;
+			const unsigned char* previousRow = y > 0 ? row - rowStep : nullptr;
+			filterRow(row, previousRow, rowLength, filtered.data() + (size_t)i * (rowLength + 1));
+		}
+		band.adler = adler32(1, filtered.data(), (uInt)filtered.size());
+
+		z_stream stream;
+		memset(&stream, 0, sizeof(stream));
+		if (deflateInit2(&stream, compressionLevel, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		{
+			band.compressed.clear();
+			return false;
+		}
+		band.compressed.resize(deflateBound(&stream, (uLong)filtered.size()) + 16);
+		stream.next_in = filtered.data();
+		stream.avail_in = (uInt)filtered.size();
+		stream.next_out = band.compressed.data();
+		stream.avail_out = (uInt)band.compressed.size();
+		const int ret = deflate(&stream, isLast ? Z_FINISH : Z_SYNC_FLUSH);
+		// The output holds deflateBound bytes, so all input must be consumed in one call.
+		const bool isComplete = (isLast ? ret == Z_STREAM_END : ret == Z_OK) && stream.avail_in == 0;
+		band.compressed.resize(isComplete ? stream.total_out : 0);
+		deflateEnd(&stream);
+		return isComplete;
+	}
+}
+
+std::vector<unsigned char> PNG::encodePixels(const FrameBuffer & buffer, const int compressionLevel, int bandCount)
+{
+	const int width = buffer.getWidth();
+	const int height = buffer.getHeight();
+	const size_t rowBytes = (size_t)width * 3 + 1;
+	const unsigned char* topRow = buffer.getTopRow();
+
+	if (bandCount <= 0)
+	{
+		const int minRowsPerBand = 32;
+		bandCount = JobSystem::get().getWorkerCount();
+		bandCount = std::min(bandCount, std::max(1, height / minRowsPerBand));
+	}
+	bandCount = std::max(1, std::min(bandCount, height));
+
+	std::vector<Band> bands(bandCount);
+	for (int i = 0; i < bandCount; i++)
+	{
+		bands[i].firstRow = height * i / bandCount;
+		bands[i].rowCount = height * (i + 1) / bandCount - bands[i].firstRow;
+	}
+
+	std::atomic<bool> isFailed(false);
+	JobSystem::get().parallelFor(bandCount, 1, [&](int first, int last) {
+		for (int i = first; i < last; i++)
+		{
+			if (compressBand(topRow, width, buffer.getRowStep(), compressionLevel, i == bandCount - 1, bands[i]) == false)
+			{
+				isFailed.store(true, std::memory_order_relaxed);
+			}
+		}
+	});
+	if (isFailed.load(std::memory_order_relaxed))
+	{
+		spdlog::error("PNG: deflate failed");
+		return std::vector<unsigned char>();
+	}
+
+	std::vector<unsigned char> idat;
+	idat.push_back(0x78);
+	idat.push_back(0x01);
+	unsigned long adler = 1;
+	for (const Band& band : bands)
+	{
+		idat.insert(idat.end(), band.compressed.begin(), band.compressed.end());
+		adler = adler32_combine(adler, band.adler, (z_off_t)(rowBytes * band.rowCount));
+	}
+	appendUInt32(idat, (unsigned int)adler);
+
+	std::vector<unsigned char> bytes;
+	bytes.reserve(idat.size() + 64);
+	const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	bytes.insert(bytes.end(), signature, signature + 8);
+
+	std::vector<unsigned char> header;
+	appendUInt32(header, width);
+	appendUInt32(header, height);
+	header.insert(header.end(), { 8, 2, 0, 0, 0 });
+	appendChunk(bytes, "IHDR", header.data(), header.size());
+	appendChunk(bytes, "IDAT", idat.data(), idat.size());
+	appendChunk(bytes, "IEND", nullptr, 0);
+	return bytes;
+}
+
+void PNG::writePxielsToFile(const FrameBuffer & buffer, std::string filename)
+{
+	const std::vector<unsigned char> bytes = encodePixels(buffer);
+	if (bytes.empty())
+	{
+		return;
+	}
+	std::ofstream f(filename, std::ios::binary);
+	f.write((const char*)bytes.data(), bytes.size());
+}
@@ -1,25 +1,27 @@
 #include "PPM.hpp"
 #include <fstream> 
+#include <string.h>
+
+#include "Util.hpp"
 
 void PPM::writePxielsToFile(const FrameBuffer & buffer, std::string filename)
 {
 	std::ofstream f(filename);
 	const int width = buffer.getWidth();
 	const int height = buffer.getHeight();
-	const unsigned char*  data = buffer.getData();
 	f << "P3" << std::endl;
 	f << std::to_string(width) << " " << std::to_string(height) << std::endl;
 	f << "255" << std::endl;
 	
 	for (int i = 0; i < height; i++)
 	{
+		const unsigned char* row = buffer.getTopRow() + i * buffer.getRowStep();
 		for (int j = 0; j < width; j++)
 		{
-			int idx = i * width + j;
-			idx = idx * 3;
-			const unsigned char r = data[idx];
-			const unsigned char g = data[idx+1];
-			const unsigned char b = data[idx+2];
+			const int idx = j * 3;
+			const unsigned char r = row[idx];
+			const unsigned char g = row[idx+1];
+			const unsigned char b = row[idx+2];
 
 			f << std::to_string(r) << " ";
 			f << std::to_string(g) << " ";
@@ -42,7 +44,8 @@ void PPM::writeZBufferToFile(const FrameBuffer & buffer, std::string filename)
 	{
 		for (int j = 0; j < width; j++)
 		{
-			int idx = i * width + j;
+			const int row = buffer.getOrigin() == FrameBufferOrigin::bottomLeft ? height - 1 - i : i;
+			const int idx = row * buffer.getPitch() + j;
 			const unsigned char z = static_cast<const unsigned char>(zBuffer[idx] * 255.0);
 			f << std::to_string(z) << " ";
 			f << std::to_string(z) << " ";
@@ -51,3 +54,42 @@ void PPM::writeZBufferToFile(const FrameBuffer & buffer, std::string filename)
 		f << std::endl;
 	}
 }
+
+void PPM::writeHeatmapToFile(const DebugBuffers & buffers, const DebugBufferType type, std::string filename)
+{
+	std::ofstream f(filename);
+	const int width = buffers.getWidth();
+	const int height = buffers.getHeight();
+	const double maxValue = glm::max(1.0, (double)buffers.getMaxValue(type));
+	f << "P3" << std::endl;
+	f << std::to_string(width) << " " << std::to_string(height) << std::endl;
+	f << "255" << std::endl;
+	for (int i = 0; i < height; i++)
+	{
+		for (int j = 0; j < width; j++)
+		{
+			const unsigned int value = buffers.getValue(type, glm::ivec2(j, i));
+			const glm::vec3 color = value == 0 ? Color::black : heatmapColor(value / maxValue);
+			f << std::to_string((int)(color.r * 255.0)) << " ";
+			f << std::to_string((int)(color.g * 255.0)) << " ";
+			f << std::to_string((int)(color.b * 255.0)) << " ";
+		}
+		f << std::endl;
+	}
+}
+
+std::vector<unsigned char> PPM::encodePixels(const FrameBuffer & buffer)
+{
+	const int width = buffer.getWidth();
+	const int height = buffer.getHeight();
+	const std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+	const size_t length = (size_t)width * height * 3;
+	std::vector<unsigned char> bytes(header.size() + length);
+	memcpy(bytes.data(), header.data(), header.size());
+	const size_t rowLength = (size_t)width * 3;
+	for (int y = 0; y < height; y++)
+	{
+		memcpy(bytes.data() + header.size() + y * rowLength, buffer.getTopRow() + y * buffer.getRowStep(), rowLength);
+	}
+	return bytes;
+}
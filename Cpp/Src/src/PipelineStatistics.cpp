@@ -0,0 +1,31 @@
+#include "PipelineStatistics.hpp"
+
+double PipelineStatistics::overdraw(const int pixelCount) const noexcept
+{
+	if (pixelCount <= 0)
+	{
+		return 0.0;
+	}
+	return (double)(fragmentsShaded + fragmentsBroadcast) / ((double)pixelCount * samplesPerPixel);
+}
+
+void PipelineStatistics::reset() noexcept
+{
+	*this = PipelineStatistics();
+}
+
+void PipelineStatistics::add(const PipelineStatistics & other) noexcept
+{
+	verticesShaded += other.verticesShaded;
+	trianglesCulled += other.trianglesCulled;
+	trianglesClipped += other.trianglesClipped;
+	trianglesRasterized += other.trianglesRasterized;
+	pixelsTested += other.pixelsTested;
+	fragmentsClipped += other.fragmentsClipped;
+	depthPasses += other.depthPasses;
+	depthFails += other.depthFails;
+	earlyDepthFails += other.earlyDepthFails;
+	stencilFails += other.stencilFails;
+	fragmentsShaded += other.fragmentsShaded;
+	fragmentsBroadcast += other.fragmentsBroadcast;
+}
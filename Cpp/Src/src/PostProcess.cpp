@@ -0,0 +1,492 @@
+#include "PostProcess.hpp"
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "spdlog/spdlog.h"
+
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SR_POST_PROCESS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	template<typename Body>
+	void forEachRowBand(const int height, const Body& body)
+	{
+		// By reference, so std::function does not allocate for the capturing lambda.
+		JobSystem::get().parallelFor(height, PostProcessChain::rowsPerJob, std::ref(body));
+	}
+
+	/*
+	destination[i] += weight * source[i], the inner loop of both blur passes.
+	*/
+	void addScaled(float* destination, const float* source, const float weight, const int count)
+	{
+		int i = 0;
+#if defined(SR_POST_PROCESS_SSE2)
+		const __m128 weights = _mm_set1_ps(weight);
+		for (; i + 4 <= count; i += 4)
+		{
+			_mm_storeu_ps(destination + i, _mm_add_ps(_mm_loadu_ps(destination + i), _mm_mul_ps(weights, _mm_loadu_ps(source + i))));
+		}
+#endif
+		for (; i < count; i++)
+		{
+			destination[i] += weight * source[i];
+		}
+	}
+
+#if defined(SR_POST_PROCESS_SSE2)
+	/*
+	log2 of positive normal floats: exponent plus a degree 5 polynomial of the mantissa, relative error below 1e-6.
+	*/
+	__m128 log2Approximation(const __m128 x)
+	{
+		const __m128i bits = _mm_castps_si128(x);
+		const __m128 exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+		const __m128 mantissa = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+		__m128 p = _mm_set1_ps(-3.4436006e-2f);
+		p = _mm_add_ps(_mm_mul_ps(p, mantissa), _mm_set1_ps(3.1821337e-1f));
+		p = _mm_add_ps(_mm_mul_ps(p, mantissa), _mm_set1_ps(-1.2315303f));
+		p = _mm_add_ps(_mm_mul_ps(p, mantissa), _mm_set1_ps(2.5988452f));
+		p = _mm_add_ps(_mm_mul_ps(p, mantissa), _mm_set1_ps(-3.3241990f));
+		p = _mm_add_ps(_mm_mul_ps(p, mantissa), _mm_set1_ps(3.1157899f));
+		return _mm_add_ps(_mm_mul_ps(p, _mm_sub_ps(mantissa, _mm_set1_ps(1.0f))), exponent);
+	}
+
+	/*
+	2^x: integer part into the exponent bits, fraction through a degree 5 polynomial. x is clamped to the normal range.
+	*/
+	__m128 exp2Approximation(__m128 x)
+	{
+		x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-126.99f)), _mm_set1_ps(127.99f));
+		// Rounding x - 0.5 to nearest is floor(x) for the default rounding mode.
+		const __m128i integer = _mm_cvtps_epi32(_mm_sub_ps(x, _mm_set1_ps(0.5f)));
+		const __m128 fraction = _mm_sub_ps(x, _mm_cvtepi32_ps(integer));
+		const __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(integer, _mm_set1_epi32(127)), 23));
+		__m128 p = _mm_set1_ps(1.8775767e-3f);
+		p = _mm_add_ps(_mm_mul_ps(p, fraction), _mm_set1_ps(8.9893397e-3f));
+		p = _mm_add_ps(_mm_mul_ps(p, fraction), _mm_set1_ps(5.5826318e-2f));
+		p = _mm_add_ps(_mm_mul_ps(p, fraction), _mm_set1_ps(2.4015361e-1f));
+		p = _mm_add_ps(_mm_mul_ps(p, fraction), _mm_set1_ps(6.9315308e-1f));
+		p = _mm_add_ps(_mm_mul_ps(p, fraction), _mm_set1_ps(9.9999994e-1f));
+		return _mm_mul_ps(scale, p);
+	}
+#endif
+
+	float luma(const glm::vec3 color)
+	{
+		return glm::dot(color, glm::vec3(0.299f, 0.587f, 0.114f));
+	}
+
+	glm::vec3 pixelAt(const PostProcessImage& image, const int x, const int y)
+	{
+		const float* pixel = image.row(std::clamp(y, 0, image.getHeight() - 1)) + (size_t)std::clamp(x, 0, image.getWidth() - 1) * 3;
+		return glm::vec3(pixel[0], pixel[1], pixel[2]);
+	}
+}
+
+PostProcessImage::PostProcessImage()
+{
+
+}
+
+int PostProcessImage::getWidth() const
+{
+	return width;
+}
+
+int PostProcessImage::getHeight() const
+{
+	return height;
+}
+
+void PostProcessImage::resize(const int width, const int height)
+{
+	assert(width > 0 && height > 0);
+	const size_t size = (size_t)width * height * 3 * sizeof(float);
+	if (size > pixels.size())
+	{
+		pixels.reset(size);
+	}
+	this->width = width;
+	this->height = height;
+}
+
+const float * PostProcessImage::row(const int y) const
+{
+	return static_cast<const float*>(pixels.data()) + (size_t)y * width * 3;
+}
+
+float * PostProcessImage::mutableRow(const int y)
+{
+	return static_cast<float*>(pixels.mutableData()) + (size_t)y * width * 3;
+}
+
+glm::vec3 PostProcessImage::sample(const float x, const float y) const
+{
+	const float clampedX = std::clamp(x, 0.0f, (float)(width - 1));
+	const float clampedY = std::clamp(y, 0.0f, (float)(height - 1));
+	const int x0 = (int)clampedX;
+	const int y0 = (int)clampedY;
+	const float fx = clampedX - x0;
+	const float fy = clampedY - y0;
+	const glm::vec3 top = glm::mix(pixelAt(*this, x0, y0), pixelAt(*this, x0 + 1, y0), fx);
+	const glm::vec3 bottom = glm::mix(pixelAt(*this, x0, y0 + 1), pixelAt(*this, x0 + 1, y0 + 1), fx);
+	return glm::mix(top, bottom, fy);
+}
+
+int PostProcessEffect::getPassCount() const
+{
+	return 1;
+}
+
+glm::ivec2 PostProcessEffect::getOutputSize(const int pass, const glm::ivec2 inputSize) const
+{
+	return inputSize;
+}
+
+PostProcessInput ToneMapEffect::getInput(const int pass) const
+{
+	return PostProcessInput::pixel;
+}
+
+void ToneMapEffect::run(const int pass, const PostProcessImage & source, PostProcessImage & destination, const int firstRow, const int lastRow) const
+{
+	const int count = destination.getWidth() * 3;
+	for (int y = firstRow; y < lastRow; y++)
+	{
+		float* values = destination.mutableRow(y);
+		int i = 0;
+#if defined(SR_POST_PROCESS_SSE2)
+		const __m128 scale = _mm_set1_ps(exposure);
+		const __m128 one = _mm_set1_ps(1.0f);
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128 x = _mm_mul_ps(_mm_loadu_ps(values + i), scale);
+			__m128 mapped;
+			if (toneMapOperator == ToneMapOperator::reinhard)
+			{
+				mapped = _mm_div_ps(x, _mm_add_ps(one, x));
+			}
+			else
+			{
+				// Narkowicz's fit of the ACES filmic curve.
+				const __m128 numerator = _mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(2.51f)), _mm_set1_ps(0.03f)));
+				const __m128 denominator = _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(2.43f)), _mm_set1_ps(0.59f))), _mm_set1_ps(0.14f));
+				mapped = _mm_min_ps(_mm_max_ps(_mm_div_ps(numerator, denominator), _mm_setzero_ps()), one);
+			}
+			_mm_storeu_ps(values + i, mapped);
+		}
+#endif
+		for (; i < count; i++)
+		{
+			const float x = values[i] * exposure;
+			if (toneMapOperator == ToneMapOperator::reinhard)
+			{
+				values[i] = x / (1.0f + x);
+			}
+			else
+			{
+				values[i] = std::clamp((x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f), 0.0f, 1.0f);
+			}
+		}
+	}
+}
+
+PostProcessInput GammaEffect::getInput(const int pass) const
+{
+	return PostProcessInput::pixel;
+}
+
+void GammaEffect::run(const int pass, const PostProcessImage & source, PostProcessImage & destination, const int firstRow, const int lastRow) const
+{
+	const float exponent = 1.0f / gamma;
+	const int count = destination.getWidth() * 3;
+	for (int y = firstRow; y < lastRow; y++)
+	{
+		float* values = destination.mutableRow(y);
+		int i = 0;
+#if defined(SR_POST_PROCESS_SSE2)
+		// pow as exp2(exponent * log2(x)); values at or below the smallest normal float come out as 0.
+		const __m128 exponents = _mm_set1_ps(exponent);
+		const __m128 smallest = _mm_set1_ps(1.17549435e-38f);
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128 x = _mm_loadu_ps(values + i);
+			const __m128 mapped = exp2Approximation(_mm_mul_ps(exponents, log2Approximation(_mm_max_ps(x, smallest))));
+			_mm_storeu_ps(values + i, _mm_and_ps(mapped, _mm_cmpgt_ps(x, smallest)));
+		}
+#endif
+		for (; i < count; i++)
+		{
+			values[i] = std::pow(std::max(values[i], 0.0f), exponent);
+		}
+	}
+}
+
+PostProcessInput FxaaEffect::getInput(const int pass) const
+{
+	return PostProcessInput::neighbourhood;
+}
+
+void FxaaEffect::run(const int pass, const PostProcessImage & source, PostProcessImage & destination, const int firstRow, const int lastRow) const
+{
+	const float reduceMultiplier = 1.0f / 8.0f;
+	const float reduceMin = 1.0f / 128.0f;
+	const int width = destination.getWidth();
+	for (int y = firstRow; y < lastRow; y++)
+	{
+		float* out = destination.mutableRow(y);
+		for (int x = 0; x < width; x++)
+		{
+			const glm::vec3 colorM = pixelAt(source, x, y);
+			const float lumaM = luma(colorM);
+			const float lumaNW = luma(pixelAt(source, x - 1, y - 1));
+			const float lumaNE = luma(pixelAt(source, x + 1, y - 1));
+			const float lumaSW = luma(pixelAt(source, x - 1, y + 1));
+			const float lumaSE = luma(pixelAt(source, x + 1, y + 1));
+			const float lumaMin = std::min(lumaM, std::min(std::min(lumaNW, lumaNE), std::min(lumaSW, lumaSE)));
+			const float lumaMax = std::max(lumaM, std::max(std::max(lumaNW, lumaNE), std::max(lumaSW, lumaSE)));
+
+			glm::vec3 color = colorM;
+			if (lumaMax - lumaMin >= std::max(contrastThreshold, lumaMax * relativeThreshold))
+			{
+				// The gradient points across the edge; its perpendicular is the direction to blend along.
+				glm::vec2 direction(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+				const float directionReduce = std::max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25f * reduceMultiplier, reduceMin);
+				const float inverseDirectionMin = 1.0f / (std::min(std::abs(direction.x), std::abs(direction.y)) + directionReduce);
+				direction = glm::clamp(direction * inverseDirectionMin, glm::vec2(-spanMax), glm::vec2(spanMax));
+
+				const glm::vec3 colorA = 0.5f * (source.sample(x + direction.x * (1.0f / 3.0f - 0.5f), y + direction.y * (1.0f / 3.0f - 0.5f))
+					+ source.sample(x + direction.x * (2.0f / 3.0f - 0.5f), y + direction.y * (2.0f / 3.0f - 0.5f)));
+				const glm::vec3 colorB = colorA * 0.5f + 0.25f * (source.sample(x - direction.x * 0.5f, y - direction.y * 0.5f)
+					+ source.sample(x + direction.x * 0.5f, y + direction.y * 0.5f));
+				const float lumaB = luma(colorB);
+				color = (lumaB < lumaMin || lumaB > lumaMax) ? colorA : colorB;
+			}
+			out[x * 3] = color.r;
+			out[x * 3 + 1] = color.g;
+			out[x * 3 + 2] = color.b;
+		}
+	}
+}
+
+GaussianBlurEffect::GaussianBlurEffect(const float sigma)
+{
+	assert(sigma > 0.0f);
+	radius = std::max(1, (int)std::ceil(sigma * 3.0f));
+	weights.resize(radius * 2 + 1);
+	float sum = 0.0f;
+	for (int i = -radius; i <= radius; i++)
+	{
+		weights[i + radius] = std::exp(-(float)(i * i) / (2.0f * sigma * sigma));
+		sum += weights[i + radius];
+	}
+	for (float& weight : weights)
+	{
+		weight /= sum;
+	}
+}
+
+int GaussianBlurEffect::getPassCount() const
+{
+	return 2;
+}
+
+PostProcessInput GaussianBlurEffect::getInput(const int pass) const
+{
+	return PostProcessInput::neighbourhood;
+}
+
+void GaussianBlurEffect::run(const int pass, const PostProcessImage & source, PostProcessImage & destination, const int firstRow, const int lastRow) const
+{
+	const int width = source.getWidth();
+	const int height = source.getHeight();
+	for (int y = firstRow; y < lastRow; y++)
+	{
+		float* out = destination.mutableRow(y);
+		std::fill_n(out, (size_t)width * 3, 0.0f);
+		if (pass == 1)
+		{
+			// Vertical: whole rows are weighted and added, which vectorizes across the row.
+			for (int i = -radius; i <= radius; i++)
+			{
+				addScaled(out, source.row(std::clamp(y + i, 0, height - 1)), weights[i + radius], width * 3);
+			}
+			continue;
+		}
+
+		// Horizontal: the pixels whose kernel stays inside the row are shifted rows added with one weight each,
+		// the few pixels at the borders clamp their taps.
+		const float* in = source.row(y);
+		const int innerFirst = std::min(radius, width);
+		const int innerLast = std::max(innerFirst, width - radius);
+		if (innerLast > innerFirst)
+		{
+			for (int i = -radius; i <= radius; i++)
+			{
+				addScaled(out + innerFirst * 3, in + (innerFirst + i) * 3, weights[i + radius], (innerLast - innerFirst) * 3);
+			}
+		}
+		for (int x = 0; x < width; x++)
+		{
+			if (x == innerFirst && innerLast > innerFirst)
+			{
+				x = innerLast - 1;
+				continue;
+			}
+			for (int i = -radius; i <= radius; i++)
+			{
+				const float* tap = in + std::clamp(x + i, 0, width - 1) * 3;
+				const float weight = weights[i + radius];
+				out[x * 3] += weight * tap[0];
+				out[x * 3 + 1] += weight * tap[1];
+				out[x * 3 + 2] += weight * tap[2];
+			}
+		}
+	}
+}
+
+PostProcessInput DownsampleEffect::getInput(const int pass) const
+{
+	return PostProcessInput::neighbourhood;
+}
+
+glm::ivec2 DownsampleEffect::getOutputSize(const int pass, const glm::ivec2 inputSize) const
+{
+	return glm::ivec2((inputSize.x + 1) / 2, (inputSize.y + 1) / 2);
+}
+
+void DownsampleEffect::run(const int pass, const PostProcessImage & source, PostProcessImage & destination, const int firstRow, const int lastRow) const
+{
+	const int width = destination.getWidth();
+	const int sourceWidth = source.getWidth();
+	for (int y = firstRow; y < lastRow; y++)
+	{
+		const float* top = source.row(std::min(y * 2, source.getHeight() - 1));
+		const float* bottom = source.row(std::min(y * 2 + 1, source.getHeight() - 1));
+		float* out = destination.mutableRow(y);
+		for (int x = 0; x < width; x++)
+		{
+			const int left = x * 2 * 3;
+			const int right = std::min(x * 2 + 1, sourceWidth - 1) * 3;
+			for (int channel = 0; channel < 3; channel++)
+			{
+				out[x * 3 + channel] = 0.25f * (top[left + channel] + top[right + channel] + bottom[left + channel] + bottom[right + channel]);
+			}
+		}
+	}
+}
+
+void PostProcessChain::add(PostProcessEffect * effect)
+{
+	assert(effect);
+	effects.push_back(effect);
+}
+
+void PostProcessChain::clear()
+{
+	effects.clear();
+}
+
+bool PostProcessChain::isEmpty() const
+{
+	return effects.empty();
+}
+
+glm::ivec2 PostProcessChain::getOutputSize(const glm::ivec2 inputSize) const
+{
+	glm::ivec2 size = inputSize;
+	for (const PostProcessEffect* effect : effects)
+	{
+		for (int pass = 0; pass < effect->getPassCount(); pass++)
+		{
+			size = effect->getOutputSize(pass, size);
+		}
+	}
+	return size;
+}
+
+void PostProcessChain::run(const FrameBuffer & source, FrameBuffer & target)
+{
+	SR_PROFILE_SCOPE("post");
+	const glm::ivec2 outputSize = getOutputSize(glm::ivec2(source.getWidth(), source.getHeight()));
+	if (target.getWidth() != outputSize.x || target.getHeight() != outputSize.y)
+	{
+		spdlog::error("PostProcessChain: target is {}x{}, the chain produces {}x{}", target.getWidth(), target.getHeight(), outputSize.x, outputSize.y);
+		assert(false);
+		return;
+	}
+
+	int current = 0;
+	images[current].resize(source.getWidth(), source.getHeight());
+	forEachRowBand(source.getHeight(), [&](int first, int last) {
+		for (int y = first; y < last; y++)
+		{
+			const unsigned char* in = source.getData() + (size_t)y * source.getPitch() * 3;
+			float* out = images[current].mutableRow(y);
+			for (int i = 0; i < source.getWidth() * 3; i++)
+			{
+				out[i] = in[i] * (1.0f / 255.0f);
+			}
+		}
+	});
+
+	// Runs of pixel passes are fused: every band goes through all of them while its rows are in cache.
+	pixelPasses.clear();
+	const auto flushPixelPasses = [&]() {
+		if (pixelPasses.empty())
+		{
+			return;
+		}
+		PostProcessImage& image = images[current];
+		forEachRowBand(image.getHeight(), [&](int first, int last) {
+			for (const auto& pixelPass : pixelPasses)
+			{
+				pixelPass.first->run(pixelPass.second, image, image, first, last);
+			}
+		});
+		pixelPasses.clear();
+	};
+	for (const PostProcessEffect* effect : effects)
+	{
+		for (int pass = 0; pass < effect->getPassCount(); pass++)
+		{
+			if (effect->getInput(pass) == PostProcessInput::pixel)
+			{
+				pixelPasses.emplace_back(effect, pass);
+				continue;
+			}
+			flushPixelPasses();
+			const PostProcessImage& in = images[current];
+			PostProcessImage& out = images[1 - current];
+			const glm::ivec2 size = effect->getOutputSize(pass, glm::ivec2(in.getWidth(), in.getHeight()));
+			out.resize(size.x, size.y);
+			forEachRowBand(size.y, [&](int first, int last) {
+				effect->run(pass, in, out, first, last);
+			});
+			current = 1 - current;
+		}
+	}
+	flushPixelPasses();
+
+	const PostProcessImage& result = images[current];
+	forEachRowBand(result.getHeight(), [&](int first, int last) {
+		for (int y = first; y < last; y++)
+		{
+			const float* in = result.row(y);
+			unsigned char* out = target.mutableData() + (size_t)y * target.getPitch() * 3;
+			for (int i = 0; i < result.getWidth() * 3; i++)
+			{
+				out[i] = (unsigned char)(std::clamp(in[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+			}
+		}
+	});
+}
@@ -0,0 +1,146 @@
+#include "Profiler.hpp"
+#include <assert.h>
+#include <fstream>
+
+#include "spdlog/spdlog.h"
+
+Profiler & Profiler::get()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+Profiler::Profiler()
+	:origin(std::chrono::steady_clock::now())
+{
+
+}
+
+Profiler::ThreadEvents & Profiler::getThreadEvents()
+{
+	// Profiler is a singleton, so one pointer per thread is enough; the events outlive the thread.
+	thread_local ThreadEvents* threadEvents = nullptr;
+	if (threadEvents == nullptr)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		threads.push_back(std::unique_ptr<ThreadEvents>(new ThreadEvents()));
+		threadEvents = threads.back().get();
+		threadEvents->threadIndex = (int)threads.size() - 1;
+	}
+	return *threadEvents;
+}
+
+void Profiler::addEvent(const char * name, const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end)
+{
+	Event event;
+	event.name = name;
+	event.start = std::chrono::duration<double, std::micro>(start - origin).count();
+	event.duration = std::chrono::duration<double, std::micro>(end - start).count();
+
+	ThreadEvents& threadEvents = getThreadEvents();
+	std::lock_guard<std::mutex> lock(threadEvents.mutex);
+	if (threadEvents.events.size() >= maxEventsPerThread)
+	{
+		threadEvents.droppedCount++;
+		return;
+	}
+	threadEvents.events.push_back(event);
+}
+
+void Profiler::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const std::unique_ptr<ThreadEvents>& threadEvents : threads)
+	{
+		std::lock_guard<std::mutex> threadLock(threadEvents->mutex);
+		threadEvents->events.clear();
+		threadEvents->droppedCount = 0;
+	}
+}
+
+bool Profiler::writeChromeTrace(const std::string & filename)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::ofstream f(filename);
+	if (f.is_open() == false)
+	{
+		spdlog::error("Profiler: can not open {}", filename);
+		return false;
+	}
+	f << "{\"traceEvents\":[" << std::endl;
+	bool isFirst = true;
+	size_t droppedCount = 0;
+	for (const std::unique_ptr<ThreadEvents>& threadEvents : threads)
+	{
+		std::lock_guard<std::mutex> threadLock(threadEvents->mutex);
+		for (const Event& event : threadEvents->events)
+		{
+			f << (isFirst ? "" : ",\n");
+			f << fmt::format("{{\"name\":\"{}\",\"cat\":\"SoftwareRendering\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":0,\"tid\":{}}}",
+				event.name, event.start, event.duration, threadEvents->threadIndex);
+			isFirst = false;
+		}
+		droppedCount += threadEvents->droppedCount;
+	}
+	f << std::endl << "]}" << std::endl;
+	if (droppedCount > 0)
+	{
+		spdlog::warn("Profiler: {} events past {} per thread were dropped from {}", droppedCount, maxEventsPerThread, filename);
+	}
+	return true;
+}
+
+ProfileScope::ProfileScope(const char * name)
+	:name(name), start(std::chrono::steady_clock::now())
+{
+
+}
+
+ProfileScope::~ProfileScope()
+{
+	Profiler::get().addEvent(name, start, std::chrono::steady_clock::now());
+}
+
+ProfileStages::ProfileStages()
+	:start(std::chrono::steady_clock::now())
+{
+
+}
+
+ProfileStages::~ProfileStages()
+{
+	std::chrono::steady_clock::time_point stageStart = start;
+	for (int i = 0; i < stageCount; i++)
+	{
+		Profiler::get().addEvent(stages[i].name, stageStart, stageStart + stages[i].duration);
+		stageStart += stages[i].duration;
+	}
+}
+
+void ProfileStages::add(const char * name, const std::chrono::steady_clock::duration duration)
+{
+	for (int i = 0; i < stageCount; i++)
+	{
+		if (stages[i].name == name)
+		{
+			stages[i].duration += duration;
+			return;
+		}
+	}
+	assert(stageCount < maxStageCount);
+	if (stageCount < maxStageCount)
+	{
+		stages[stageCount++] = Stage{ name, duration };
+	}
+}
+
+ProfileStageScope::ProfileStageScope(ProfileStages & stages, const char * name)
+	:stages(stages), name(name), start(std::chrono::steady_clock::now())
+{
+
+}
+
+ProfileStageScope::~ProfileStageScope()
+{
+	stages.add(name, std::chrono::steady_clock::now() - start);
+}
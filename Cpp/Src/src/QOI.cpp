@@ -0,0 +1,143 @@
+#include "QOI.hpp"
+#include <fstream>
+#include <string.h>
+
+namespace
+{
+	const unsigned char opIndex = 0x00;
+	const unsigned char opDiff = 0x40;
+	const unsigned char opLuma = 0x80;
+	const unsigned char opRun = 0xc0;
+	const unsigned char opRGB = 0xfe;
+
+	struct QOIPixel
+	{
+		unsigned char r = 0;
+		unsigned char g = 0;
+		unsigned char b = 0;
+		unsigned char a = 255;
+
+		bool operator==(const QOIPixel& other) const
+		{
+			return r == other.r && g == other.g && b == other.b && a == other.a;
+		}
+
+		int hash() const
+		{
+			return (r * 3 + g * 5 + b * 7 + a * 11) % 64;
+		}
+	};
+
+	void writeUInt32(unsigned char* dst, const unsigned int value)
+	{
+		dst[0] = (unsigned char)(value >> 24);
+		dst[1] = (unsigned char)(value >> 16);
+		dst[2] = (unsigned char)(value >> 8);
+		dst[3] = (unsigned char)(value);
+	}
+}
+
+std::vector<unsigned char> QOI::encodePixels(const FrameBuffer & buffer)
+{
+	const int width = buffer.getWidth();
+	const int height = buffer.getHeight();
+	const size_t pixelCount = (size_t)width * height;
+	const int headerSize = 14;
+	const unsigned char padding[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+	// Worst case every pixel is a QOI_OP_RGB chunk.
+	std::vector<unsigned char> bytes(headerSize + pixelCount * 4 + sizeof(padding));
+	unsigned char* out = bytes.data();
+
+	memcpy(out, "qoif", 4);
+	writeUInt32(out + 4, width);
+	writeUInt32(out + 8, height);
+	out[12] = 3;
+	out[13] = 0;
+	size_t p = headerSize;
+
+	QOIPixel index[64];
+	for (QOIPixel& entry : index)
+	{
+		entry.a = 0;
+	}
+	QOIPixel previous;
+	int runLength = 0;
+
+	const unsigned char* row = buffer.getTopRow();
+	int x = 0;
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		QOIPixel pixel;
+		pixel.r = row[x * 3];
+		pixel.g = row[x * 3 + 1];
+		pixel.b = row[x * 3 + 2];
+		if (++x == width)
+		{
+			x = 0;
+			row += buffer.getRowStep();
+		}
+
+		if (pixel == previous)
+		{
+			runLength++;
+			if (runLength == 62 || i == pixelCount - 1)
+			{
+				out[p++] = opRun | (runLength - 1);
+				runLength = 0;
+			}
+			continue;
+		}
+
+		if (runLength > 0)
+		{
+			out[p++] = opRun | (runLength - 1);
+			runLength = 0;
+		}
+
+		const int hash = pixel.hash();
+		if (index[hash] == pixel)
+		{
+			out[p++] = opIndex | hash;
+		}
+		else
+		{
+			index[hash] = pixel;
+
+			const signed char dr = pixel.r - previous.r;
+			const signed char dg = pixel.g - previous.g;
+			const signed char db = pixel.b - previous.b;
+			const signed char drdg = dr - dg;
+			const signed char dbdg = db - dg;
+
+			if (dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2)
+			{
+				out[p++] = opDiff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2);
+			}
+			else if (drdg > -9 && drdg < 8 && dg > -33 && dg < 32 && dbdg > -9 && dbdg < 8)
+			{
+				out[p++] = opLuma | (dg + 32);
+				out[p++] = (drdg + 8) << 4 | (dbdg + 8);
+			}
+			else
+			{
+				out[p++] = opRGB;
+				out[p++] = pixel.r;
+				out[p++] = pixel.g;
+				out[p++] = pixel.b;
+			}
+		}
+		previous = pixel;
+	}
+
+	memcpy(out + p, padding, sizeof(padding));
+	p += sizeof(padding);
+	bytes.resize(p);
+	return bytes;
+}
+
+void QOI::writePxielsToFile(const FrameBuffer & buffer, std::string filename)
+{
+	const std::vector<unsigned char> bytes = encodePixels(buffer);
+	std::ofstream f(filename, std::ios::binary);
+	f.write((const char*)bytes.data(), bytes.size());
+}
@@ -9,4 +9,24 @@ Rect Rect::boundingBox(const glm::vec2& a, const glm::vec2& b, const glm::vec2&
 	rect.width = std::max({ a.x, b.x, c.x }) - rect.x;
 	rect.height = std::max({ a.y, b.y, c.y }) - rect.y;
 	return rect;
-}
\ No newline at end of file
+}
+
+bool PixelRect::isEmpty() const noexcept
+{
+	return width <= 0 || height <= 0;
+}
+
+bool PixelRect::contains(const int px, const int py) const noexcept
+{
+	return px >= x && px < x + width && py >= y && py < y + height;
+}
+
+PixelRect PixelRect::intersect(const PixelRect& other) const noexcept
+{
+	PixelRect rect;
+	rect.x = std::max(x, other.x);
+	rect.y = std::max(y, other.y);
+	rect.width = std::max(0, std::min(x + width, other.x + other.width) - rect.x);
+	rect.height = std::max(0, std::min(y + height, other.y + other.height) - rect.y);
+	return rect;
+}
@@ -1 +1,16 @@
 #include "RenderPipeLine.hpp"
+
+void RenderPipeline::setMesh(const Mesh & mesh)
+{
+	vertexBuffer = mesh.getVertexBuffer();
+	indexBuffer = mesh.getIndexBuffer();
+	vertexCount = mesh.getVertexCount();
+	triangleCount = mesh.getTriangleCount();
+}
+
+void RenderPipeline::setPositionStream(const Mesh & mesh)
+{
+	setMesh(mesh);
+	vertexLayout.clear();
+	vertexLayout.addAttribute(mesh.getVertexBuffer(), mesh.getVertexStride(), 0, VertexFormat::float3);
+}
@@ -1,19 +1,33 @@
 #include "Renderer.hpp"
+#include <cmath>
+#include <algorithm>
+#include <limits>
 
 #include "spdlog/spdlog.h"
 
 #include "Util.hpp"
 #include "Line2D.hpp"
+#include "Profiler.hpp"
+#include "JobSystem.hpp"
 
-Renderer::Renderer(int width, int height)
-	:frameBuffer(new FrameBuffer(width, height))
+Renderer::Renderer(int width, int height, const FrameBufferOrigin origin)
+	:frameBuffer(new FrameBuffer(width, height, origin))
+{
+
+}
+
+Renderer::Renderer(FrameBuffer & target)
+	:frameBuffer(&target), ownsFrameBuffer(false)
 {
 
 }
 
 Renderer::~Renderer()
 {
-	delete frameBuffer;
+	if (ownsFrameBuffer)
+	{
+		delete frameBuffer;
+	}
 }
 
 FrameBuffer const * const Renderer::getFrameBuffer() const
@@ -21,16 +35,65 @@ FrameBuffer const * const Renderer::getFrameBuffer() const
 	return frameBuffer;
 }
 
-void Renderer::flush() const
+FrameBuffer * Renderer::mutableFrameBuffer()
 {
+	return frameBuffer;
+}
+
+void Renderer::flush()
+{
+	SR_PROFILE_SCOPE("clear");
+	frameArena.reset();
 	frameBuffer->flush();
+	if (debugBuffers)
+	{
+		debugBuffers->clear();
+	}
+}
+
+void Renderer::flush(const TileMask & tiles, const glm::vec3 color)
+{
+	SR_PROFILE_SCOPE("clear");
+	frameArena.reset();
+	frameBuffer->flush(tiles, color);
+	if (debugBuffers)
+	{
+		debugBuffers->clear();
+	}
 }
 
 void Renderer::clear(glm::vec3 color)
 {
+	SR_PROFILE_SCOPE("clear");
 	frameBuffer->clear(color);
 }
 
+const PipelineStatistics & Renderer::getStatistics() const
+{
+	return statistics;
+}
+
+void Renderer::resetStatistics()
+{
+	statistics.reset();
+}
+
+LinearArena & Renderer::getFrameArena()
+{
+	return frameArena.forCurrentThread();
+}
+
+ArenaStatistics Renderer::getFrameArenaStatistics() const
+{
+	return frameArena.getStatistics();
+}
+
+void Renderer::setDebugBuffers(DebugBuffers * debugBuffers)
+{
+	assert(debugBuffers == nullptr || (debugBuffers->getWidth() == getWidth() && debugBuffers->getHeight() == getHeight()));
+	this->debugBuffers = debugBuffers;
+}
+
 int Renderer::getWidth() const
 {
 	return frameBuffer->getWidth();
@@ -41,7 +104,7 @@ int Renderer::getHeight() const
 	return frameBuffer->getHeight();
 }
 
-void Renderer::setColor(const glm::vec3 point, const glm::vec3 color, const std::function<bool(double, double)> depthFunc) const
+void Renderer::setColor(const glm::vec3 point, const glm::vec3 color, const DepthFunc::closure depthFunc) const
 {
 	if (isAvailable(point, depthFunc))
 	{
@@ -49,13 +112,9 @@ void Renderer::setColor(const glm::vec3 point, const glm::vec3 color, const std:
 	}
 }
 
-bool Renderer::isAvailable(const glm::vec3 point, const std::function<bool(double, double)> depthFunc) const
+bool Renderer::isAvailable(const glm::vec3 point, const DepthFunc::closure depthFunc) const
 {
-	std::function<bool(double)> check = [](double v) {
-		return v >= -1.0 && v <= 1.0;
-	};
-
-	if (check(point.x) && check(point.y))
+	if (isInsideNdc(point))
 	{
 		double z = frameBuffer->zValueAtNdcPoint(point);
 		bool isPass = depthFunc(point.z, z);
@@ -148,9 +207,9 @@ void Renderer::addTriangle2D(const glm::vec2 a, const glm::vec2 b, const glm::ve
 		break;
 
 	case PolygonModeType::fill:
-		std::vector<glm::vec2> points = { a, b, c };
+		glm::vec2 points[3] = { a, b, c };
 
-		std::sort(points.begin(), points.end(), [](glm::vec2 lhs, glm::vec2 rhs) {
+		std::sort(points, points + 3, [](glm::vec2 lhs, glm::vec2 rhs) {
 			return lhs.y < rhs.y;
 		});
 
@@ -227,7 +286,7 @@ void Renderer::addTriangle2D(const glm::vec2 p0, const glm::vec2 p1, const glm::
 
 void Renderer::addTriangle3D(const glm::vec3 p0, const glm::vec3 p1, const glm::vec3 p2, 
 	const glm::vec3 c0, const glm::vec3 c1, const glm::vec3 c2, 
-	const std::function<bool(double, double)> depthFunc) const
+	const DepthFunc::closure depthFunc) const
 {
 	if (isValidTriangle(p0, p1, p2) == false)
 	{
@@ -253,7 +312,7 @@ void Renderer::addTriangle3D(const glm::vec3 p0, const glm::vec3 p1, const glm::
 
 void Renderer::addTriangle3D(const glm::vec4 p0, const glm::vec4 p1, const glm::vec4 p2, 
 	const glm::vec3 c0, const glm::vec3 c1, const glm::vec3 c2, 
-	const std::function<bool(double, double)> depthFunc) const
+	const DepthFunc::closure depthFunc) const
 {
 	glm::vec4 a = divideByW(p0);
 	glm::vec4 b = divideByW(p1);
@@ -287,48 +346,679 @@ void Renderer::addTriangle3D(const glm::vec4 p0, const glm::vec4 p1, const glm::
 
 void Renderer::pipeline(const RenderPipeline& renderPipeLine)
 {
-	int triangleCount = renderPipeLine.triangleCount;
+	assert(renderPipeLine.instanceCount >= 0);
+	assert(renderPipeLine.instanceBuffer == nullptr || renderPipeLine.instanceStride > 0);
+	if (renderPipeLine.vertexLayout.isEmpty() == false && renderPipeLine.shader->supportsVertexLayout() == false)
+	{
+		spdlog::error("Renderer: the shader does not read vertex layouts, draw skipped");
+		return;
+	}
+	const int vertexCount = renderPipeLine.indexBuffer ? renderPipeLine.vertexCount : renderPipeLine.triangleCount * 3;
+
+	// Vertex outputs only live for their instance and the vertex array for the draw, so neither piles up until flush.
+	LinearArena::Scope arenaScope(frameArena.forCurrentThread());
+	FrameArena::TransientScope drawScope(frameArena);
+	ArenaVector<RasterizationData> vertices(vertexCount);
+	for (int instanceIdx = 0; instanceIdx < renderPipeLine.instanceCount; instanceIdx++)
+	{
+		FrameArena::TransientScope instanceScope(frameArena);
+		shadeVertices(renderPipeLine, instanceIdx, vertices);
+		drawTriangles(renderPipeLine, vertices);
+	}
+}
+
+void Renderer::execute(CommandBuffer & commandBuffer)
+{
+	commandBuffer.sort();
+	for (int i = 0; i < commandBuffer.getPacketCount(); i++)
+	{
+		const DrawPacket& packet = commandBuffer.getSortedPacket(i);
+		if (packet.bindUniforms)
+		{
+			packet.bindUniforms();
+		}
+		pipeline(packet.pipeline);
+	}
+}
+
+void Renderer::coverage(const RenderPipeline & renderPipeLine, TileMask & tiles)
+{
+	SR_PROFILE_SCOPE("coverage");
+	assert(tiles.getWidth() == getWidth() && tiles.getHeight() == getHeight());
+	const PixelRect clipRect = pipelineClipRect(renderPipeLine);
+	// Draws pipeline skips cover nothing.
+	if (clipRect.isEmpty() || (renderPipeLine.vertexLayout.isEmpty() == false && renderPipeLine.shader->supportsVertexLayout() == false))
+	{
+		return;
+	}
+	const bool hasViewport = renderPipeLine.viewport.isEmpty() == false;
+	const glm::vec4 viewport = hasViewport ? viewportTransform(renderPipeLine.viewport) : glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+	const unsigned int* indexBuffer = renderPipeLine.indexBuffer;
+	const int vertexCount = indexBuffer ? renderPipeLine.vertexCount : renderPipeLine.triangleCount * 3;
+
+	LinearArena::Scope arenaScope(frameArena.forCurrentThread());
+	FrameArena::TransientScope drawScope(frameArena);
+	ArenaVector<RasterizationData> vertices(vertexCount);
+	for (int instanceIdx = 0; instanceIdx < renderPipeLine.instanceCount; instanceIdx++)
+	{
+		FrameArena::TransientScope instanceScope(frameArena);
+		shadeVertices(renderPipeLine, instanceIdx, vertices);
+		for (int i = 0; i < renderPipeLine.triangleCount; i++)
+		{
+			glm::vec4 points[3];
+			for (int j = 0; j < 3; j++)
+			{
+				points[j] = divideByW(vertices[indexBuffer ? indexBuffer[3 * i + j] : 3 * i + j].position);
+				if (hasViewport)
+				{
+					points[j] = glm::vec4(glm::vec2(points[j]) * glm::vec2(viewport) + glm::vec2(viewport.z, viewport.w), points[j].z, points[j].w);
+				}
+			}
+			if (isValidTriangle(points[0], points[1], points[2]))
+			{
+				tiles.addRect(pixelBounds(Rect::boundingBox(points[0], points[1], points[2])).intersect(clipRect));
+			}
+		}
+	}
+}
+
+void Renderer::shadeVertices(const RenderPipeline & renderPipeLine, const int instanceIdx, ArenaVector<RasterizationData>& vertices)
+{
+	SR_PROFILE_SCOPE("vertex");
+	const int vertexCount = (int)vertices.size();
+	const VertexLayout& vertexLayout = renderPipeLine.vertexLayout;
+	Shader* shader = renderPipeLine.shader;
+	const void* instance = renderPipeLine.instanceBuffer
+		? static_cast<const char*>(renderPipeLine.instanceBuffer) + (size_t)instanceIdx * renderPipeLine.instanceStride
+		: nullptr;
+
+	// Blocks of vertices are shaded as jobs; a block is also the unit the layout gathers into scratch that stays in cache.
+	const int blockSize = 256;
+	const auto shadeBlock = [&](int first, int last) {
+		// Vertex outputs are allocated from the arena of the thread running the block.
+		LinearArena::Scope arenaScope(frameArena.forCurrentThread());
+		if (vertexLayout.isEmpty() && instance == nullptr)
+		{
+			for (int i = first; i < last; i++)
+			{
+				vertices[i] = shader->vertexShader(renderPipeLine.vertexBuffer, i);
+			}
+		}
+		else if (vertexLayout.isEmpty())
+		{
+			VertexInput input;
+			input.vertexBuffer = renderPipeLine.vertexBuffer;
+			input.instance = instance;
+			input.instanceIdx = instanceIdx;
+			for (int i = first; i < last; i++)
+			{
+				input.vertexIdx = i;
+				vertices[i] = shader->vertexShader(input);
+			}
+		}
+		else
+		{
+			glm::vec4 attributes[blockSize * VertexLayout::maxAttributeCount];
+			const int attributeCount = vertexLayout.getAttributeCount();
+			vertexLayout.gather(first, last - first, attributes);
+			VertexInput input;
+			input.attributeCount = attributeCount;
+			input.instance = instance;
+			input.instanceIdx = instanceIdx;
+			for (int i = first; i < last; i++)
+			{
+				input.attributes = attributes + (size_t)(i - first) * attributeCount;
+				input.vertexIdx = i;
+				vertices[i] = shader->vertexShader(input);
+			}
+		}
+	};
+	// Passed by reference: std::function stores a reference_wrapper without allocating, unlike the capturing lambda.
+	JobSystem::get().parallelFor(vertexCount, blockSize, std::ref(shadeBlock));
+	SR_STAT_ADD(statistics, verticesShaded, vertexCount);
+}
+
+template<CompareOp depthCompare>
+void Renderer::drawTrianglesKernel(const RenderPipeline & renderPipeLine, const ArenaVector<RasterizationData>& vertices)
+{
+	const int triangleCount = renderPipeLine.triangleCount;
+	const unsigned int* indexBuffer = renderPipeLine.indexBuffer;
+
+	const bool hasViewport = renderPipeLine.viewport.isEmpty() == false;
+	const glm::vec4 viewport = hasViewport ? viewportTransform(renderPipeLine.viewport) : glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+	const TileMask* tileMask = renderPipeLine.tileMask;
+	assert(tileMask == nullptr || (tileMask->getWidth() == getWidth() && tileMask->getHeight() == getHeight()));
+	PixelRect clipRect = pipelineClipRect(renderPipeLine);
+	if (tileMask)
+	{
+		clipRect = clipRect.intersect(tileMask->getBounds());
+	}
+	if (clipRect.isEmpty())
+	{
+		return;
+	}
+	const bool isClipped = tileMask || clipRect.width != getWidth() || clipRect.height != getHeight();
+	// Samples outside a clip rectangle (plus a pixel of margin and the triangle's sampleMargin) are skipped without
+	// moving the sample grid, so the pixels inside come out exactly as in an unclipped draw. The fragment stage does the
+	// exact per pixel test.
+	const auto clipBounds = [this](const PixelRect& rect) {
+		const Rect ndc = frameBuffer->pixelRectToNdc(rect);
+		const double marginX = 2.0 / (double)(getWidth() - 1);
+		const double marginY = 2.0 / (double)(getHeight() - 1);
+		return Rect{ ndc.x - marginX, ndc.y - marginY, ndc.width + 2.0 * marginX, ndc.height + 2.0 * marginY };
+	};
+	const Rect clipNdc = clipBounds(clipRect);
+
+	const bool isDepthOnly = renderPipeLine.isDepthOnly;
+	const DepthStencilState& depthStencil = renderPipeLine.depthStencil;
+	const bool isStencilEnabled = depthStencil.isStencilEnabled;
+	const unsigned char stencilReference = depthStencil.stencilReference & depthStencil.stencilReadMask;
+	double* zBuffer = frameBuffer->mutableZBuffer();
+	unsigned char* stencilBuffer = frameBuffer->mutableStencilBuffer();
+	const auto writeStencil = [&depthStencil](unsigned char& stencil, const StencilOp op) {
+		const unsigned char value = applyStencilOp(op, stencil, depthStencil.stencilReference);
+		stencil = (stencil & ~depthStencil.stencilWriteMask) | (value & depthStencil.stencilWriteMask);
+	};
+	// Fresh stamps are 0 and reserveStamps never hands out 0, so resizing needs no reset of currentStamp.
+	if (isStencilEnabled && pixelStamps.size() != (size_t)getWidth() * getHeight())
+	{
+		pixelStamps.assign((size_t)getWidth() * getHeight(), 0);
+	}
 
-	for (int i = 0; i < triangleCount; i++)
+	const int drawShadingRate = (int)renderPipeLine.shadingRate;
+	const ShadingRate* shadingRateTiles = renderPipeLine.shadingRateTiles;
+	const int shadingRateTileSize = renderPipeLine.shadingRateTileSize;
+	const int shadingRateTileColumns = shadingRateTiles ? (getWidth() + shadingRateTileSize - 1) / shadingRateTileSize : 0;
+	assert(shadingRateTiles == nullptr || (shadingRateTileSize > 0 && shadingRateTileSize % 4 == 0));
+	const bool isCoarse = isDepthOnly == false && (drawShadingRate > 1 || shadingRateTiles);
+	assert(isCoarse == false || tileMask == nullptr || tileMask->getTileSize() % 4 == 0);
+	const int coarseColumns = (getWidth() + 1) / 2;
+	if (isCoarse && coarseStamps.size() != (size_t)coarseColumns * ((getHeight() + 1) / 2))
 	{
-		const RasterizationData data0 = renderPipeLine.shader->vertexShader(renderPipeLine.vertexBuffer, 3 * i + 0);
-		const RasterizationData data1 = renderPipeLine.shader->vertexShader(renderPipeLine.vertexBuffer, 3 * i + 1);
-		const RasterizationData data2 = renderPipeLine.shader->vertexShader(renderPipeLine.vertexBuffer, 3 * i + 2);
-		assert(data0.extraData.size() == data1.extraData.size() == data2.extraData.size());
-		glm::vec4 a = divideByW(data0.position);
-		glm::vec4 b = divideByW(data1.position);
-		glm::vec4 c = divideByW(data2.position);
+		coarseStamps.assign((size_t)coarseColumns * ((getHeight() + 1) / 2), 0);
+		coarseColors.resize(coarseStamps.size());
+	}
 
-		if (isValidTriangle(a, b, c) == false)
+	struct TriangleSetup
+	{
+		glm::vec4 a;
+		glm::vec4 b;
+		glm::vec4 c;
+		Rect box;
+		glm::vec2 sampleMargin;
+		int index = 0;
+	};
+	// Triangles are set up and culled once for the whole draw; the bands below only read the result.
+	ArenaVector<TriangleSetup> triangles;
+	triangles.reserve(triangleCount);
+	// Pixels under the boxes of the triangles, split by whether every band has to rasterize the whole box.
+	double coveredPixels = 0.0;
+	double unboundedPixels = 0.0;
+	{
+		SR_PROFILE_SCOPE("setup");
+		for (int i = 0; i < triangleCount; i++)
 		{
-			continue;
+			TriangleSetup setup;
+			setup.index = i;
+			const glm::vec4& position0 = vertices[indexBuffer ? indexBuffer[3 * i + 0] : 3 * i + 0].position;
+			const glm::vec4& position1 = vertices[indexBuffer ? indexBuffer[3 * i + 1] : 3 * i + 1].position;
+			const glm::vec4& position2 = vertices[indexBuffer ? indexBuffer[3 * i + 2] : 3 * i + 2].position;
+			setup.a = divideByW(position0);
+			setup.b = divideByW(position1);
+			setup.c = divideByW(position2);
+			if (hasViewport)
+			{
+				setup.a = glm::vec4(glm::vec2(setup.a) * glm::vec2(viewport) + glm::vec2(viewport.z, viewport.w), setup.a.z, setup.a.w);
+				setup.b = glm::vec4(glm::vec2(setup.b) * glm::vec2(viewport) + glm::vec2(viewport.z, viewport.w), setup.b.z, setup.b.w);
+				setup.c = glm::vec4(glm::vec2(setup.c) * glm::vec2(viewport) + glm::vec2(viewport.z, viewport.w), setup.c.z, setup.c.w);
+			}
+
+			if (isValidTriangle(setup.a, setup.b, setup.c) == false)
+			{
+				SR_STAT_ADD(statistics, trianglesCulled, 1);
+				continue;
+			}
+			const Rect box = Rect::boundingBox(setup.a, setup.b, setup.c);
+			if (box.x < -1.0 || box.y < -1.0 || box.x + box.width > 1.0 || box.y + box.height > 1.0)
+			{
+				SR_STAT_ADD(statistics, trianglesClipped, 1);
+			}
+			setup.sampleMargin = perspectiveMargin(box, position0.z, position1.z, position2.z);
+			// Fragments of a triangle with an unbounded margin can land outside its box, so the box can not cull it.
+			const bool isBounded = std::isinf(setup.sampleMargin.x) == false;
+			if (isClipped && isBounded && (box.x > clipNdc.x + clipNdc.width || box.y > clipNdc.y + clipNdc.height || box.x + box.width < clipNdc.x || box.y + box.height < clipNdc.y))
+			{
+				SR_STAT_ADD(statistics, trianglesCulled, 1);
+				continue;
+			}
+			if (tileMask && isBounded && tileMask->intersects(pixelBounds(box)) == false)
+			{
+				SR_STAT_ADD(statistics, trianglesCulled, 1);
+				continue;
+			}
+			SR_STAT_ADD(statistics, trianglesRasterized, 1);
+			setup.box = box;
+			triangles.push_back(setup);
+			if (isBounded)
+			{
+				coveredPixels += std::min(box.width, 2.0) * std::min(box.height, 2.0) * 0.25 * getWidth() * getHeight();
+			}
+			else
+			{
+				unboundedPixels += box.width * box.height * 0.25 * getWidth() * getHeight();
+			}
 		}
-		Rect box = Rect::boundingBox(a, b, c);
+	}
+	if (triangles.empty())
+	{
+		return;
+	}
+	// Triangle k of the list owns stamp firstStamp + k in every band.
+	const unsigned int firstStamp = isStencilEnabled || isCoarse ? reserveStamps((unsigned int)triangles.size()) : 0;
 
-		for (double y = box.y; y <= box.y + box.height; y += (double)1.0 / (double)getHeight())
+	// Large draws are split into bands of rows that run as jobs. A band rasterizes every triangle near its rows and keeps
+	// only the fragments of its own pixels, so bands write disjoint pixels and each pixel still sees its fragments in
+	// triangle order. Band rows start at multiples of 4, so no coarse shading block spans two bands. Debug buffers count
+	// per triangle and keep the draw in one band, as do draws whose unbounded triangles would cost more rasterized by
+	// every band than the split saves.
+	const int minBandPixels = 64 * 64;
+	const int minBandHeight = 16;
+	const int bandsPerWorker = 4;
+	const int workerCount = JobSystem::get().getWorkerCount();
+	int bandHeight = clipRect.height;
+	int firstBandRow = clipRect.y;
+	int bandCount = 1;
+	if (debugBuffers == nullptr && workerCount > 1 && coveredPixels >= minBandPixels
+		&& unboundedPixels * bandsPerWorker < coveredPixels)
+	{
+		bandHeight = std::max(minBandHeight, (clipRect.height / (workerCount * bandsPerWorker) + 3) / 4 * 4);
+		firstBandRow = clipRect.y / bandHeight * bandHeight;
+		bandCount = (clipRect.y + clipRect.height - firstBandRow + bandHeight - 1) / bandHeight;
+	}
+	ArenaVector<PipelineStatistics> bandStatistics(bandCount);
+
+	const auto drawBands = [&](int firstBand, int lastBand) {
+		// Fragments and fragment inputs are allocated from the arena of the thread running the band.
+		LinearArena::Scope arenaScope(frameArena.forCurrentThread());
+		for (int band = firstBand; band < lastBand; band++)
 		{
-			for (double x = box.x; x <= box.x + box.width; x += (double)1.0 / (double)getWidth())
+			PixelRect bandRect = clipRect;
+			if (bandCount > 1)
 			{
-				BarycentricTestResult testResult = BarycentricTestResult::test(a, b, c, x, y);
-				if (testResult.isInsideTriangle)
+				bandRect = PixelRect{ clipRect.x, firstBandRow + band * bandHeight, clipRect.width, bandHeight }.intersect(clipRect);
+			}
+			const bool isBandClipped = isClipped || bandCount > 1;
+			const Rect bandNdc = clipBounds(bandRect);
+			const double clipLeft = bandNdc.x;
+			const double clipRight = bandNdc.x + bandNdc.width;
+			const double clipBottom = bandNdc.y;
+			const double clipTop = bandNdc.y + bandNdc.height;
+			PipelineStatistics& bandCounters = bandStatistics[band];
+			ArenaVector<Fragment> fragments;
+			// One fragment input for the band; its extraData keeps its storage from fragment to fragment.
+			RasterizationData data;
+			// The per triangle stages are summed over the band and recorded once each.
+			SR_PROFILE_STAGES(stages);
+			for (int k = 0; k < (int)triangles.size(); k++)
+			{
+				const TriangleSetup& setup = triangles[k];
+				const glm::vec4& a = setup.a;
+				const glm::vec4& b = setup.b;
+				const glm::vec4& c = setup.c;
+				const Rect& box = setup.box;
+				const glm::vec2 sampleMargin = isBandClipped ? setup.sampleMargin : glm::vec2(0.0f);
+				// Already counted by the setup pass; other bands rasterize it.
+				if (bandCount > 1 && std::isinf(sampleMargin.x) == false && (box.x > clipRight || box.y > clipTop || box.x + box.width < clipLeft || box.y + box.height < clipBottom))
+				{
+					continue;
+				}
+				const int i = setup.index;
+				const RasterizationData& data0 = vertices[indexBuffer ? indexBuffer[3 * i + 0] : 3 * i + 0];
+				const RasterizationData& data1 = vertices[indexBuffer ? indexBuffer[3 * i + 1] : 3 * i + 1];
+				const RasterizationData& data2 = vertices[indexBuffer ? indexBuffer[3 * i + 2] : 3 * i + 2];
+				assert(data0.extraData.size() == data1.extraData.size() && data1.extraData.size() == data2.extraData.size());
+				const int extraDataCount = (int)data0.extraData.size();
+				data.extraData.resize(extraDataCount);
+				const unsigned int stamp = firstStamp + k;
+				if (debugBuffers)
+				{
+					debugBuffers->beginTriangle();
+				}
+
+				fragments.clear();
+				{
+					SR_PROFILE_STAGE(stages, "raster");
+					// Samples are addressed by index from the box origin, so a clipped draw jumps straight to the samples near
+					// the clip rectangle and still visits exactly the samples an unclipped draw would. The index range is one
+					// sample wider than needed on each side; the exact tests below trim it.
+					const double right = box.x + box.width;
+					const double top = box.y + box.height;
+					const double stepX = 1.0 / (double)getWidth();
+					const double stepY = 1.0 / (double)getHeight();
+					const double maxIndex = 1e9;
+					int firstColumn = 0;
+					int lastColumn = (int)std::min(box.width * getWidth(), maxIndex) + 1;
+					int firstRow = 0;
+					int lastRow = (int)std::min(box.height * getHeight(), maxIndex) + 1;
+					if (isBandClipped)
+					{
+						firstColumn = (int)std::min(std::max(0.0, std::floor((clipLeft - sampleMargin.x - box.x) * getWidth()) - 1.0), maxIndex);
+						lastColumn = std::min(lastColumn, (int)std::min(std::max(0.0, std::ceil((clipRight + sampleMargin.x - box.x) * getWidth()) + 1.0), maxIndex));
+						firstRow = (int)std::min(std::max(0.0, std::floor((clipBottom - sampleMargin.y - box.y) * getHeight()) - 1.0), maxIndex);
+						lastRow = std::min(lastRow, (int)std::min(std::max(0.0, std::ceil((clipTop + sampleMargin.y - box.y) * getHeight()) + 1.0), maxIndex));
+					}
+					for (int row = firstRow; row <= lastRow; row++)
+					{
+						const double y = box.y + row * stepY;
+						if (y > top)
+						{
+							break;
+						}
+						if (isBandClipped && (y < clipBottom - sampleMargin.y || y > clipTop + sampleMargin.y))
+						{
+							continue;
+						}
+						for (int column = firstColumn; column <= lastColumn; column++)
+						{
+							const double x = box.x + column * stepX;
+							if (x > right)
+							{
+								break;
+							}
+							if (isBandClipped && (x < clipLeft - sampleMargin.x || x > clipRight + sampleMargin.x))
+							{
+								continue;
+							}
+							SR_STAT_ADD(bandCounters, pixelsTested, 1);
+							BarycentricTestResult testResult = BarycentricTestResult::test(a, b, c, x, y);
+							if (testResult.isInsideTriangle)
+							{
+								Fragment fragment;
+								fragment.testResult = testResult;
+								fragments.push_back(fragment);
+							}
+						}
+					}
+				}
+
+				{
+					SR_PROFILE_STAGE(stages, "fragment");
+					for (Fragment& fragment : fragments)
+					{
+						const BarycentricTestResult& testResult = fragment.testResult;
+						const glm::vec3 point = vec3Correction(a, b, c, data0.position.z, data1.position.z, data2.position.z, testResult);
+						float zAtScreenSapce = zCorrection(a.z, b.z, c.z, data0.position.z, data1.position.z, data2.position.z, testResult);
+						fragment.point = glm::vec3(point.x, point.y, zAtScreenSapce);
+						if (isInsideNdc(fragment.point) == false)
+						{
+							fragment.isRejected = true;
+							SR_STAT_ADD(bandCounters, fragmentsClipped, 1);
+							continue;
+						}
+						if (isBandClipped)
+						{
+							const glm::ivec2 pixel = frameBuffer->ndcPointToPixelIndex(fragment.point);
+							if (bandRect.contains(pixel.x, pixel.y) == false || (tileMask && tileMask->containsPixel(pixel.x, pixel.y) == false))
+							{
+								// Pixels of another band are left to it; clipped pixels are counted by the band of the nearest row.
+								fragment.isRejected = true;
+								const int nearestRow = std::min(std::max(pixel.y, clipRect.y), clipRect.y + clipRect.height - 1);
+								const bool isOtherBand = clipRect.contains(pixel.x, pixel.y) && (tileMask == nullptr || tileMask->containsPixel(pixel.x, pixel.y));
+								if (isOtherBand == false && nearestRow >= bandRect.y && nearestRow < bandRect.y + bandRect.height)
+								{
+									SR_STAT_ADD(bandCounters, fragmentsClipped, 1);
+								}
+								continue;
+							}
+						}
+						fragment.bufferIndex = frameBuffer->ndcPointToBufferIndex(fragment.point);
+						if (debugBuffers)
+						{
+							debugBuffers->addTriangleCoverage(frameBuffer->ndcPointToPixelIndex(fragment.point));
+						}
+
+						if (isStencilEnabled)
+						{
+							// The raster loop samples a pixel several times; only its first fragment takes part in stencil draws.
+							const glm::ivec2 pixel = frameBuffer->ndcPointToPixelIndex(fragment.point);
+							unsigned int& pixelStamp = pixelStamps[(size_t)pixel.y * getWidth() + pixel.x];
+							if (pixelStamp == stamp)
+							{
+								fragment.isRejected = true;
+								continue;
+							}
+							pixelStamp = stamp;
+
+							unsigned char& stencil = stencilBuffer[fragment.bufferIndex];
+							if (compare(depthStencil.stencilCompare, stencilReference, (unsigned char)(stencil & depthStencil.stencilReadMask)) == false)
+							{
+								writeStencil(stencil, depthStencil.stencilFailOp);
+								fragment.isRejected = true;
+								SR_STAT_ADD(bandCounters, stencilFails, 1);
+								continue;
+							}
+						}
+
+						// Shaders can not change depth, so fragments hidden by earlier draws are rejected before shading.
+						if (debugBuffers)
+						{
+							debugBuffers->addDepthTest(frameBuffer->ndcPointToPixelIndex(fragment.point));
+						}
+						if (compare<depthCompare>((double)fragment.point.z, zBuffer[fragment.bufferIndex]) == false)
+						{
+							if (isStencilEnabled)
+							{
+								writeStencil(stencilBuffer[fragment.bufferIndex], depthStencil.depthFailOp);
+							}
+							fragment.isRejected = true;
+							SR_STAT_ADD(bandCounters, depthFails, 1);
+							SR_STAT_ADD(bandCounters, earlyDepthFails, 1);
+							continue;
+						}
+						if (isDepthOnly)
+						{
+							// Nothing to shade: the test above ran against every earlier fragment, so it is final.
+							SR_STAT_ADD(bandCounters, depthPasses, 1);
+							if (depthStencil.isDepthWriteEnabled)
+							{
+								zBuffer[fragment.bufferIndex] = fragment.point.z;
+							}
+							if (isStencilEnabled)
+							{
+								writeStencil(stencilBuffer[fragment.bufferIndex], depthStencil.passOp);
+							}
+							continue;
+						}
+
+						size_t coarseIndex = SIZE_MAX;
+						if (isCoarse)
+						{
+							const glm::ivec2 pixel = frameBuffer->ndcPointToPixelIndex(fragment.point);
+							int rate = drawShadingRate;
+							if (shadingRateTiles)
+							{
+								rate = std::max(rate, (int)shadingRateTiles[(pixel.y / shadingRateTileSize) * shadingRateTileColumns + pixel.x / shadingRateTileSize]);
+							}
+							if (rate > 1)
+							{
+								// A 4x4 block is keyed by its top left 2x2 cell; tiles are multiples of 4, so blocks never mix rates.
+								coarseIndex = (size_t)(pixel.y / rate * (rate / 2)) * coarseColumns + pixel.x / rate * (rate / 2);
+								if (coarseStamps[coarseIndex] == stamp)
+								{
+									fragment.color = coarseColors[coarseIndex];
+									SR_STAT_ADD(bandCounters, fragmentsBroadcast, 1);
+									continue;
+								}
+							}
+						}
+
+						glm::vec3 interpolationP = interpolation(testResult.weight(), glm::vec3(a), glm::vec3(b), glm::vec3(c));
+						data.position = glm::vec4(interpolationP, 1.0);
+						for (int i = 0; i < extraDataCount; i++)
+						{
+							data.extraData[i] = vec4Correction(data0.extraData[i], data1.extraData[i], data2.extraData[i], data0.position.z, data1.position.z, data2.position.z, testResult);
+						}
+						fragment.color = renderPipeLine.shader->fragmentShader(data);
+						SR_STAT_ADD(bandCounters, fragmentsShaded, 1);
+						if (coarseIndex != SIZE_MAX)
+						{
+							coarseStamps[coarseIndex] = stamp;
+							coarseColors[coarseIndex] = fragment.color;
+						}
+						if (debugBuffers && isInsideNdc(fragment.point))
+						{
+							debugBuffers->addFragmentShaded(frameBuffer->ndcPointToPixelIndex(fragment.point));
+						}
+					}
+				}
+
+				if (isDepthOnly == false)
 				{
-					glm::vec3 interpolationP = interpolation(testResult.weight(), glm::vec3(a), glm::vec3(b), glm::vec3(c));
-					const glm::vec3 point = vec3Correction(a, b, c, data0.position.z, data1.position.z, data2.position.z, testResult);
-					float zAtScreenSapce = zCorrection(a.z, b.z, c.z, data0.position.z, data1.position.z, data2.position.z, testResult);
-					RasterizationData data;
-					data.position = glm::vec4(interpolationP, 1.0);
-					for (int i = 0; i < data0.extraData.size(); i++)
+					SR_PROFILE_STAGE(stages, "depth/write");
+					for (const Fragment& fragment : fragments)
 					{
-						glm::vec4 interpolationData = interpolation(testResult.weight(), data0.extraData[i], data1.extraData[i], data2.extraData[i]);
-						interpolationData = vec4Correction(data0.extraData[i], data1.extraData[i], data2.extraData[i], data0.position.z, data1.position.z, data2.position.z, testResult);
-						data.extraData.push_back(interpolationData);
+						if (fragment.isRejected)
+						{
+							continue;
+						}
+						// Tested again: an earlier fragment of the same triangle may have covered the same pixel.
+						double& z = zBuffer[fragment.bufferIndex];
+						if (compare<depthCompare>((double)fragment.point.z, z))
+						{
+							SR_STAT_ADD(bandCounters, depthPasses, 1);
+							if (depthStencil.isDepthWriteEnabled)
+							{
+								z = fragment.point.z;
+							}
+							frameBuffer->setPixel(fragment.bufferIndex, glm::vec3(fragment.color));
+							if (isStencilEnabled)
+							{
+								writeStencil(stencilBuffer[fragment.bufferIndex], depthStencil.passOp);
+							}
+						}
+						else
+						{
+							SR_STAT_ADD(bandCounters, depthFails, 1);
+							if (isStencilEnabled)
+							{
+								writeStencil(stencilBuffer[fragment.bufferIndex], depthStencil.depthFailOp);
+							}
+						}
 					}
-					glm::vec4 color = renderPipeLine.shader->fragmentShader(data);
-					setColor(glm::vec3(point.x, point.y, zAtScreenSapce), color, renderPipeLine.depthFunc);
 				}
 			}
 		}
+	};
+	// Passed by reference: std::function stores a reference_wrapper without allocating, unlike the capturing lambda.
+	JobSystem::get().parallelFor(bandCount, 1, std::ref(drawBands));
+	for (const PipelineStatistics& counters : bandStatistics)
+	{
+		statistics.add(counters);
+	}
+}
+
+void Renderer::drawTriangles(const RenderPipeline & renderPipeLine, const ArenaVector<RasterizationData>& vertices)
+{
+	// The compare op is resolved once per draw instead of once per pixel.
+	switch (renderPipeLine.depthStencil.depthCompare)
+	{
+	case CompareOp::never:
+		drawTrianglesKernel<CompareOp::never>(renderPipeLine, vertices);
+		break;
+	case CompareOp::less:
+		drawTrianglesKernel<CompareOp::less>(renderPipeLine, vertices);
+		break;
+	case CompareOp::equal:
+		drawTrianglesKernel<CompareOp::equal>(renderPipeLine, vertices);
+		break;
+	case CompareOp::lequal:
+		drawTrianglesKernel<CompareOp::lequal>(renderPipeLine, vertices);
+		break;
+	case CompareOp::greater:
+		drawTrianglesKernel<CompareOp::greater>(renderPipeLine, vertices);
+		break;
+	case CompareOp::notequal:
+		drawTrianglesKernel<CompareOp::notequal>(renderPipeLine, vertices);
+		break;
+	case CompareOp::gequal:
+		drawTrianglesKernel<CompareOp::gequal>(renderPipeLine, vertices);
+		break;
+	case CompareOp::always:
+		drawTrianglesKernel<CompareOp::always>(renderPipeLine, vertices);
+		break;
+	}
+}
+
+unsigned int Renderer::reserveStamps(const unsigned int count)
+{
+	if (count > std::numeric_limits<unsigned int>::max() - currentStamp)
+	{
+		std::fill(pixelStamps.begin(), pixelStamps.end(), 0u);
+		std::fill(coarseStamps.begin(), coarseStamps.end(), 0u);
+		currentStamp = 0;
+	}
+	const unsigned int firstStamp = currentStamp + 1;
+	currentStamp += count;
+	return firstStamp;
+}
+
+PixelRect Renderer::pipelineClipRect(const RenderPipeline & renderPipeLine) const
+{
+	PixelRect clipRect = { 0, 0, getWidth(), getHeight() };
+	if (renderPipeLine.viewport.isEmpty() == false)
+	{
+		clipRect = clipRect.intersect(renderPipeLine.viewport);
+	}
+	if (renderPipeLine.scissor.isEmpty() == false)
+	{
+		clipRect = clipRect.intersect(renderPipeLine.scissor);
+	}
+	return clipRect;
+}
+
+glm::vec2 Renderer::perspectiveMargin(const Rect & box, const double z0, const double z1, const double z2)
+{
+	if (z0 == z1 && z1 == z2)
+	{
+		return glm::vec2(0.0f);
+	}
+	const bool isSameSign = (z0 > 0.0 && z1 > 0.0 && z2 > 0.0) || (z0 < 0.0 && z1 < 0.0 && z2 < 0.0);
+	if (isSameSign == false)
+	{
+		return glm::vec2(std::numeric_limits<float>::infinity());
+	}
+	// The corrected weights are the sample weights scaled by 1 / z over their weighted sum. With factors at most ratio
+	// apart, the weights shift by at most (sqrt(ratio) - 1) / (sqrt(ratio) + 1) in total, and the point by that fraction
+	// of the box size. They also stay convex, so the point never leaves the box.
+	const double nearest = std::min({ std::abs(z0), std::abs(z1), std::abs(z2) });
+	const double farthest = std::max({ std::abs(z0), std::abs(z1), std::abs(z2) });
+	const double root = std::sqrt(farthest / nearest);
+	return glm::vec2(box.width, box.height) * (float)((root - 1.0) / (root + 1.0));
+}
+
+PixelRect Renderer::pixelBounds(const Rect & box) const
+{
+	// A pixel of margin absorbs the rounding between the raster samples and the corrected fragment points.
+	const PixelRect rect = frameBuffer->ndcRectToPixels(box);
+	if (rect.isEmpty())
+	{
+		return rect;
 	}
+	return PixelRect{ rect.x - 1, rect.y - 1, rect.width + 2, rect.height + 2 };
+}
+
+glm::vec4 Renderer::viewportTransform(const PixelRect & viewport) const
+{
+	// Same mapping as FrameBuffer::ndcPointToPixelIndex, with the viewport size in place of the buffer size.
+	const int width = getWidth();
+	const int height = getHeight();
+	assert(width > 1 && height > 1);
+	const int bottom = frameBuffer->getOrigin() == FrameBufferOrigin::topLeft ? height - viewport.y - viewport.height : viewport.y;
+	const float xScale = (float)(viewport.width - 1) / (float)(width - 1);
+	const float yScale = (float)(viewport.height - 1) / (float)(height - 1);
+	const float xOffset = 2.0f * viewport.x / (float)(width - 1) + xScale - 1.0f;
+	const float yOffset = 2.0f * bottom / (float)(height - 1) + yScale - 1.0f;
+	return glm::vec4(xScale, yScale, xOffset, yOffset);
 }
 
 bool Renderer::isValidTriangle(const glm::vec2 a, const glm::vec2 b, const glm::vec2 c) const
@@ -342,3 +1032,8 @@ bool Renderer::isValidTriangle(const glm::vec2 a, const glm::vec2 b, const glm::
 	}
 	return false;
 }
+
+bool Renderer::isInsideNdc(const glm::vec2 point) const
+{
+	return point.x >= -1.0 && point.x <= 1.0 && point.y >= -1.0 && point.y <= 1.0;
+}
@@ -0,0 +1,161 @@
+#include "Scene.hpp"
+#include <assert.h>
+#include <algorithm>
+
+#include "Renderer.hpp"
+#include "RenderPipeLine.hpp"
+#include "Profiler.hpp"
+
+int Scene::addNode(const Mesh * mesh, const glm::mat4x4 & localTransform, const int parent)
+{
+	assert(parent < (int)nodes.size());
+	SceneNode node;
+	node.parent = parent;
+	node.localTransform = localTransform;
+	node.mesh = mesh;
+	nodes.push_back(node);
+	isStructureDirty = true;
+	return (int)nodes.size() - 1;
+}
+
+void Scene::setLocalTransform(const int nodeIndex, const glm::mat4x4 & localTransform)
+{
+	assert(nodeIndex >= 0 && nodeIndex < (int)nodes.size());
+	nodes[nodeIndex].localTransform = localTransform;
+}
+
+void Scene::setOccluder(const int nodeIndex, const bool isOccluder)
+{
+	assert(nodeIndex >= 0 && nodeIndex < (int)nodes.size());
+	nodes[nodeIndex].isOccluder = isOccluder;
+}
+
+const SceneNode & Scene::getNode(const int nodeIndex) const
+{
+	assert(nodeIndex >= 0 && nodeIndex < (int)nodes.size());
+	return nodes[nodeIndex];
+}
+
+int Scene::getNodeCount() const
+{
+	return (int)nodes.size();
+}
+
+void Scene::update()
+{
+	SR_PROFILE_SCOPE("scene update");
+	if (isStructureDirty)
+	{
+		drawableNodes.clear();
+	}
+	drawableBounds.clear();
+
+	for (int i = 0; i < (int)nodes.size(); i++)
+	{
+		SceneNode& node = nodes[i];
+		node.worldTransform = node.parent < 0 ? node.localTransform : nodes[node.parent].worldTransform * node.localTransform;
+		if (node.mesh == nullptr || node.mesh->getBounds().isValid() == false)
+		{
+			continue;
+		}
+		node.worldBounds = node.mesh->getBounds().transform(node.worldTransform);
+		if (isStructureDirty)
+		{
+			drawableNodes.push_back(i);
+		}
+		drawableBounds.push_back(node.worldBounds);
+	}
+
+	if (isStructureDirty)
+	{
+		bvh.build(drawableBounds);
+		isStructureDirty = false;
+	}
+	else
+	{
+		bvh.refit(drawableBounds);
+	}
+}
+
+void Scene::renderOccluders(OcclusionBuffer & occlusionBuffer, const Frustum & frustum)
+{
+	visibleItems.clear();
+	cull(frustum, visibleItems);
+	for (const int nodeIndex : visibleItems)
+	{
+		const SceneNode& node = nodes[nodeIndex];
+		if (node.isOccluder)
+		{
+			occlusionBuffer.addOccluder(*node.mesh, node.worldTransform);
+		}
+	}
+}
+
+void Scene::cull(const Frustum & frustum, std::vector<int>& visibleNodes, const OcclusionBuffer* occlusionBuffer) const
+{
+	SR_PROFILE_SCOPE("cull");
+	assert(isStructureDirty == false);
+	const size_t first = visibleNodes.size();
+	bvh.query(frustum, visibleNodes);
+	size_t count = first;
+	for (size_t i = first; i < visibleNodes.size(); i++)
+	{
+		const int nodeIndex = drawableNodes[visibleNodes[i]];
+		const SceneNode& node = nodes[nodeIndex];
+		if (occlusionBuffer && node.isOccluder == false && occlusionBuffer->isVisible(node.worldBounds) == false)
+		{
+			continue;
+		}
+		visibleNodes[count++] = nodeIndex;
+	}
+	visibleNodes.resize(count);
+}
+
+int Scene::draw(Renderer & renderer, const Frustum & frustum, const std::function<Shader*(const SceneNode&)>& bindShader, const OcclusionBuffer* occlusionBuffer)
+{
+	visibleItems.clear();
+	cull(frustum, visibleItems, occlusionBuffer);
+	for (const int nodeIndex : visibleItems)
+	{
+		const SceneNode& node = nodes[nodeIndex];
+		RenderPipeline pipeline;
+		pipeline.shader = bindShader(node);
+		pipeline.setMesh(*node.mesh);
+		renderer.pipeline(pipeline);
+	}
+	return (int)visibleItems.size();
+}
+
+int Scene::drawInstanced(Renderer & renderer, const Frustum & frustum, Shader * shader, const OcclusionBuffer* occlusionBuffer)
+{
+	visibleItems.clear();
+	cull(frustum, visibleItems, occlusionBuffer);
+	std::sort(visibleItems.begin(), visibleItems.end(), [this](const int lhs, const int rhs) {
+		return nodes[lhs].mesh < nodes[rhs].mesh || (nodes[lhs].mesh == nodes[rhs].mesh && lhs < rhs);
+	});
+
+	size_t first = 0;
+	while (first < visibleItems.size())
+	{
+		const Mesh* mesh = nodes[visibleItems[first]].mesh;
+		instances.clear();
+		size_t last = first;
+		while (last < visibleItems.size() && nodes[visibleItems[last]].mesh == mesh)
+		{
+			ModelInstance instance;
+			instance.modelMat = nodes[visibleItems[last]].worldTransform;
+			instances.push_back(instance);
+			last++;
+		}
+
+		RenderPipeline pipeline;
+		pipeline.shader = shader;
+		pipeline.setMesh(*mesh);
+		pipeline.instanceCount = (int)instances.size();
+		pipeline.instanceBuffer = instances.data();
+		pipeline.instanceStride = sizeof(ModelInstance);
+		renderer.pipeline(pipeline);
+		first = last;
+	}
+	return (int)visibleItems.size();
+}
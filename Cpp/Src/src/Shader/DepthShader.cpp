@@ -0,0 +1,30 @@
+#include "DepthShader.hpp"
+
+RasterizationData DepthShader::vertexShader(const void * vertexBuffer, const int vertexIdx)
+{
+	const glm::vec3 position = *reinterpret_cast<const glm::vec3*>(static_cast<const char*>(vertexBuffer) + (size_t)vertexIdx * vertexStride);
+	RasterizationData out;
+	out.position = projectionMat * viewMat * modelMat * glm::vec4(position, 1.0f);
+	return out;
+}
+
+RasterizationData DepthShader::vertexShader(const VertexInput & input)
+{
+	const glm::vec3 position = input.attributes
+		? glm::vec3(input.attributes[0])
+		: *reinterpret_cast<const glm::vec3*>(static_cast<const char*>(input.vertexBuffer) + (size_t)input.vertexIdx * vertexStride);
+	const ModelInstance* instance = static_cast<const ModelInstance*>(input.instance);
+	RasterizationData out;
+	out.position = projectionMat * viewMat * (instance ? instance->modelMat : modelMat) * glm::vec4(position, 1.0f);
+	return out;
+}
+
+bool DepthShader::supportsVertexLayout() const
+{
+	return true;
+}
+
+glm::vec4 DepthShader::fragmentShader(const RasterizationData & rasterizationData)
+{
+	return glm::vec4(1.0f);
+}
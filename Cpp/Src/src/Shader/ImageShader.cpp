@@ -1,4 +1,5 @@
 #include "ImageShader.hpp"
+#include <assert.h>
 
 RasterizationData ImageShader::vertexShader(const void * vertexBuffer, const int vertexIdx)
 {
@@ -9,6 +10,26 @@ RasterizationData ImageShader::vertexShader(const void * vertexBuffer, const int
 	return out;
 }
 
+RasterizationData ImageShader::vertexShader(const VertexInput & input)
+{
+	if (input.attributes == nullptr)
+	{
+		return vertexShader(input.vertexBuffer, input.vertexIdx);
+	}
+	assert(input.attributeCount >= 2);
+	const glm::vec4 position = input.attributes[0];
+	const glm::vec4 uv = input.attributes[1];
+	RasterizationData out;
+	out.position = glm::vec4(position.x, position.y, 1.0f, 1.0f);
+	out.extraData.push_back(glm::vec4(uv.x, uv.y, 1.0f, 1.0f));
+	return out;
+}
+
+bool ImageShader::supportsVertexLayout() const
+{
+	return true;
+}
+
 glm::vec4 ImageShader::fragmentShader(const RasterizationData & rasterizationData)
 {
 	glm::vec4 uv = rasterizationData.extraData[0];
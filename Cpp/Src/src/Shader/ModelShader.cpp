@@ -1,4 +1,5 @@
 #include "ModelShader.hpp"
+#include <assert.h>
 
 #include "glm/gtc/type_ptr.hpp"
 
@@ -10,12 +11,66 @@ RasterizationData ModelShader::vertexShader(const void * vertexBuffer, const int
 	RasterizationData out;
 	out.position = glm::vec4(vertex.position, 1.0f);
 	out.extraData.push_back(glm::vec4(vertex.color, 1.0));
+	if (shadowMap)
+	{
+		out.extraData.push_back(lightViewProjectionMat * modelMat * out.position);
+	}
 	glm::mat4x4 mvpMat = projectionMat * viewMat * modelMat;
 	out.position = mvpMat * out.position;
 	return out;
 }
 
+RasterizationData ModelShader::vertexShader(const VertexInput & input)
+{
+	glm::vec3 position;
+	glm::vec3 color;
+	if (input.attributes)
+	{
+		assert(input.attributeCount >= 2);
+		position = glm::vec3(input.attributes[0]);
+		color = glm::vec3(input.attributes[1]);
+	}
+	else
+	{
+		const BaseVertex vertex = static_cast<const BaseVertex*>(input.vertexBuffer)[input.vertexIdx];
+		position = vertex.position;
+		color = vertex.color;
+	}
+	const ModelInstance* instance = static_cast<const ModelInstance*>(input.instance);
+	const glm::mat4x4& instanceModelMat = instance ? instance->modelMat : modelMat;
+	const glm::mat4x4 mvpMat = projectionMat * viewMat * instanceModelMat;
+	RasterizationData out;
+	out.position = mvpMat * glm::vec4(position, 1.0f);
+	out.extraData.push_back(glm::vec4(color, 1.0) * (instance ? instance->tint : glm::vec4(1.0f)));
+	if (shadowMap)
+	{
+		out.extraData.push_back(lightViewProjectionMat * instanceModelMat * glm::vec4(position, 1.0f));
+	}
+	return out;
+}
+
+bool ModelShader::supportsVertexLayout() const
+{
+	return true;
+}
+
 glm::vec4 ModelShader::fragmentShader(const RasterizationData & rasterizationData)
 {
-	return rasterizationData.extraData[0];
+	const glm::vec4 color = rasterizationData.extraData[0];
+	if (shadowMap == nullptr || rasterizationData.extraData.size() < 2)
+	{
+		return color;
+	}
+	const glm::vec4 lightPosition = rasterizationData.extraData[1];
+	const glm::vec3 lightNdc = glm::vec3(lightPosition) / lightPosition.w;
+	if (lightNdc.x < -1.0f || lightNdc.x > 1.0f || lightNdc.y < -1.0f || lightNdc.y > 1.0f)
+	{
+		return color;
+	}
+	const double occluderDepth = shadowMap->zValueAtNdcPoint(lightNdc);
+	if (lightNdc.z - shadowBias > occluderDepth)
+	{
+		return glm::vec4(glm::vec3(color) * (1.0f - shadowIntensity), color.a);
+	}
+	return color;
 }
@@ -1,4 +1,5 @@
 #include "ModelShader2.hpp"
+#include <assert.h>
 
 RasterizationData ModelShader2::vertexShader(const void * vertexBuffer, const int vertexIdx)
 {
@@ -11,6 +12,40 @@ RasterizationData ModelShader2::vertexShader(const void * vertexBuffer, const in
 	return out;
 }
 
+RasterizationData ModelShader2::vertexShader(const VertexInput & input)
+{
+	glm::vec3 position;
+	glm::vec2 textureCoords;
+	if (input.attributes)
+	{
+		assert(input.attributeCount >= 2);
+		position = glm::vec3(input.attributes[0]);
+		textureCoords = glm::vec2(input.attributes[1]);
+	}
+	else
+	{
+		const BaseVertex2 vertex = static_cast<const BaseVertex2*>(input.vertexBuffer)[input.vertexIdx];
+		position = vertex.position;
+		textureCoords = vertex.textureCoords;
+	}
+	const ModelInstance* instance = static_cast<const ModelInstance*>(input.instance);
+	RasterizationData out;
+	const glm::mat4x4 mvpMat = projectionMat * viewMat * (instance ? instance->modelMat : modelMat);
+	out.position = mvpMat * glm::vec4(position, 1.0f);
+	const glm::vec4 coords = glm::vec4(textureCoords.x, textureCoords.y, 1.0, 1.0);
+	out.extraData.push_back(coords);
+	if (instance)
+	{
+		out.extraData.push_back(instance->tint);
+	}
+	return out;
+}
+
+bool ModelShader2::supportsVertexLayout() const
+{
+	return true;
+}
+
 glm::vec4 ModelShader2::fragmentShader(const RasterizationData & rasterizationData)
 {
 	glm::vec4 uv = rasterizationData.extraData[0];
@@ -18,6 +53,10 @@ glm::vec4 ModelShader2::fragmentShader(const RasterizationData & rasterizationDa
 	if (texture)
 	{
 		glm::vec4 color = texture->sample(_uv);
+		if (rasterizationData.extraData.size() > 1)
+		{
+			color = color * rasterizationData.extraData[1];
+		}
 		return color;
 	}
 	else
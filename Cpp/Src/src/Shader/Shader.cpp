@@ -0,0 +1,14 @@
+#include "Shader.hpp"
+#include <assert.h>
+
+RasterizationData Shader::vertexShader(const VertexInput & input)
+{
+	// Renderer::pipeline skips layout draws for shaders without layout support, so only instanced draws get here.
+	assert(input.attributes == nullptr);
+	return vertexShader(input.vertexBuffer, input.vertexIdx);
+}
+
+bool Shader::supportsVertexLayout() const
+{
+	return false;
+}
@@ -0,0 +1,287 @@
+#include "SharedFrame.hpp"
+#include <assert.h>
+#include <string.h>
+#include <new>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "spdlog/spdlog.h"
+
+namespace
+{
+	const char magic[4] = { 'S', 'R', 'S', 'F' };
+	const size_t regionAlignment = 64;
+
+	size_t alignUp(const size_t size)
+	{
+		return (size + regionAlignment - 1) / regionAlignment * regionAlignment;
+	}
+}
+
+SharedFrameBuffer::SharedFrameBuffer()
+{
+
+}
+
+SharedFrameBuffer::~SharedFrameBuffer()
+{
+	delete frameBuffer;
+#if defined(_WIN32)
+	if (mappedData)
+	{
+		UnmapViewOfFile(mappedData);
+	}
+	if (mappingHandle)
+	{
+		CloseHandle(mappingHandle);
+	}
+#else
+	if (mappedData)
+	{
+		munmap(mappedData, mappedSize);
+		shm_unlink(name.c_str());
+	}
+#endif
+}
+
+SharedFrameBuffer * SharedFrameBuffer::create(const std::string & name, int width, int height, const FrameBufferOrigin origin, const int slotCount)
+{
+	// Two slots at least, so the slot being written is never the latest one.
+	assert(width > 0 && height > 0 && slotCount >= 2 && slotCount <= SharedFrameHeader::maxSlotCount);
+	const size_t slotOffset = alignUp(sizeof(SharedFrameHeader));
+	const size_t slotBytes = alignUp((size_t)width * height * 3);
+
+	SharedFrameBuffer* sharedFrameBuffer = new SharedFrameBuffer();
+	sharedFrameBuffer->name = name;
+	sharedFrameBuffer->mappedSize = slotOffset + slotBytes * slotCount;
+
+#if defined(_WIN32)
+	const uint64_t size = sharedFrameBuffer->mappedSize;
+	sharedFrameBuffer->mappingHandle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, name.c_str());
+	if (sharedFrameBuffer->mappingHandle)
+	{
+		sharedFrameBuffer->mappedData = MapViewOfFile(sharedFrameBuffer->mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	}
+#else
+	shm_unlink(name.c_str());
+	const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd >= 0 && ftruncate(fd, (off_t)sharedFrameBuffer->mappedSize) == 0)
+	{
+		void* data = mmap(nullptr, sharedFrameBuffer->mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		sharedFrameBuffer->mappedData = data == MAP_FAILED ? nullptr : data;
+	}
+	if (fd >= 0)
+	{
+		close(fd);
+		if (sharedFrameBuffer->mappedData == nullptr)
+		{
+			shm_unlink(name.c_str());
+		}
+	}
+#endif
+
+	if (sharedFrameBuffer->mappedData == nullptr)
+	{
+		spdlog::error("SharedFrameBuffer: can not create shared memory {}", name);
+		delete sharedFrameBuffer;
+		return nullptr;
+	}
+
+	SharedFrameHeader* header = new (sharedFrameBuffer->mappedData) SharedFrameHeader();
+	memcpy(header->magic, magic, sizeof(magic));
+	header->version = SharedFrameHeader::currentVersion;
+	header->width = (uint32_t)width;
+	header->height = (uint32_t)height;
+	header->rowBytes = (uint32_t)width * 3;
+	header->format = SharedFrameFormat::rgb8;
+	header->origin = origin;
+	header->slotCount = (uint32_t)slotCount;
+	header->slotOffset = slotOffset;
+	header->slotBytes = slotBytes;
+	header->publishedFrames.store(0, std::memory_order_relaxed);
+	header->latestSlot.store(0, std::memory_order_relaxed);
+	for (SharedFrameSlot& slot : header->slots)
+	{
+		slot.sequence.store(0, std::memory_order_relaxed);
+		slot.frameIndex.store(0, std::memory_order_relaxed);
+	}
+	// Slot 0 is written first; readers see no frame until publishedFrames leaves 0.
+	header->slots[0].sequence.store(1, std::memory_order_release);
+	sharedFrameBuffer->header = header;
+	sharedFrameBuffer->frameBuffer = new FrameBuffer(width, height, sharedFrameBuffer->slotData(0), origin);
+	return sharedFrameBuffer;
+}
+
+FrameBuffer & SharedFrameBuffer::getFrameBuffer()
+{
+	return *frameBuffer;
+}
+
+void SharedFrameBuffer::publish()
+{
+	SharedFrameSlot& slot = header->slots[writeSlot];
+	const uint64_t frameIndex = header->publishedFrames.load(std::memory_order_relaxed);
+	slot.frameIndex.store(frameIndex, std::memory_order_relaxed);
+	// Back to even: the pixels and frameIndex written before become visible to readers that see this sequence.
+	slot.sequence.store(slot.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	header->latestSlot.store((uint32_t)writeSlot, std::memory_order_release);
+	header->publishedFrames.store(frameIndex + 1, std::memory_order_release);
+
+	// Round robin picks the slot published longest ago, which gives slow readers the most time.
+	writeSlot = (writeSlot + 1) % (int)header->slotCount;
+	SharedFrameSlot& next = header->slots[writeSlot];
+	next.sequence.store(next.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	// Orders the odd sequence before every pixel the next frame writes into the slot.
+	std::atomic_thread_fence(std::memory_order_release);
+	frameBuffer->setColorData(slotData(writeSlot));
+}
+
+uint64_t SharedFrameBuffer::getPublishedFrames() const
+{
+	return header->publishedFrames.load(std::memory_order_relaxed);
+}
+
+unsigned char * SharedFrameBuffer::slotData(const int slot) const
+{
+	return static_cast<unsigned char*>(mappedData) + header->slotOffset + (size_t)slot * header->slotBytes;
+}
+
+SharedFrameReader::SharedFrameReader()
+{
+
+}
+
+SharedFrameReader::~SharedFrameReader()
+{
+#if defined(_WIN32)
+	if (mappedData)
+	{
+		UnmapViewOfFile(mappedData);
+	}
+	if (mappingHandle)
+	{
+		CloseHandle(mappingHandle);
+	}
+#else
+	if (mappedData)
+	{
+		munmap(const_cast<void*>(mappedData), mappedSize);
+	}
+#endif
+}
+
+SharedFrameReader * SharedFrameReader::open(const std::string & name)
+{
+	SharedFrameReader* reader = new SharedFrameReader();
+
+#if defined(_WIN32)
+	reader->mappingHandle = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+	if (reader->mappingHandle)
+	{
+		reader->mappedData = MapViewOfFile(reader->mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		MEMORY_BASIC_INFORMATION information;
+		if (reader->mappedData && VirtualQuery(reader->mappedData, &information, sizeof(information)))
+		{
+			reader->mappedSize = information.RegionSize;
+		}
+	}
+#else
+	const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	struct stat regionStat;
+	if (fd >= 0 && fstat(fd, &regionStat) == 0 && regionStat.st_size > 0)
+	{
+		reader->mappedSize = (size_t)regionStat.st_size;
+		void* data = mmap(nullptr, reader->mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+		reader->mappedData = data == MAP_FAILED ? nullptr : data;
+	}
+	if (fd >= 0)
+	{
+		close(fd);
+	}
+#endif
+
+	if (reader->mappedData == nullptr || reader->mappedSize < sizeof(SharedFrameHeader))
+	{
+		spdlog::error("SharedFrameReader: can not map shared memory {}", name);
+		delete reader;
+		return nullptr;
+	}
+	const SharedFrameHeader* header = static_cast<const SharedFrameHeader*>(reader->mappedData);
+	if (memcmp(header->magic, magic, sizeof(magic)) != 0 || header->version != SharedFrameHeader::currentVersion
+		|| header->format != SharedFrameFormat::rgb8
+		|| (header->origin != FrameBufferOrigin::topLeft && header->origin != FrameBufferOrigin::bottomLeft)
+		|| header->slotCount < 2 || header->slotCount > (uint32_t)SharedFrameHeader::maxSlotCount
+		|| header->slotBytes < (uint64_t)header->rowBytes * header->height
+		|| header->slotOffset + header->slotBytes * header->slotCount > reader->mappedSize)
+	{
+		spdlog::error("SharedFrameReader: {} is not a shared frame buffer of version {}", name, SharedFrameHeader::currentVersion);
+		delete reader;
+		return nullptr;
+	}
+	reader->header = header;
+	return reader;
+}
+
+int SharedFrameReader::getWidth() const
+{
+	return (int)header->width;
+}
+
+int SharedFrameReader::getHeight() const
+{
+	return (int)header->height;
+}
+
+uint64_t SharedFrameReader::getPublishedFrames() const
+{
+	return header->publishedFrames.load(std::memory_order_acquire);
+}
+
+bool SharedFrameReader::acquire(SharedFrame & frame) const
+{
+	while (true)
+	{
+		if (header->publishedFrames.load(std::memory_order_acquire) == 0)
+		{
+			return false;
+		}
+		const int slot = (int)header->latestSlot.load(std::memory_order_acquire);
+		if (slot >= (int)header->slotCount)
+		{
+			return false;
+		}
+		const uint64_t sequence = header->slots[slot].sequence.load(std::memory_order_acquire);
+		if (sequence & 1)
+		{
+			// The producer went around the ring since latestSlot was read.
+			continue;
+		}
+		frame.data = static_cast<const unsigned char*>(mappedData) + header->slotOffset + (size_t)slot * header->slotBytes;
+		frame.width = (int)header->width;
+		frame.height = (int)header->height;
+		frame.rowBytes = (int)header->rowBytes;
+		frame.origin = header->origin;
+		frame.frameIndex = header->slots[slot].frameIndex.load(std::memory_order_relaxed);
+		frame.slot = slot;
+		frame.sequence = sequence;
+		if (isValid(frame))
+		{
+			return true;
+		}
+	}
+}
+
+bool SharedFrameReader::isValid(const SharedFrame & frame) const
+{
+	// Orders the reads of the frame before the sequence check.
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return header->slots[frame.slot].sequence.load(std::memory_order_relaxed) == frame.sequence;
+}
@@ -18,17 +18,6 @@ Texture2D::~Texture2D()
 	}
 }
 
-Texture2D & Texture2D::operator=(const Texture2D & texture)
-{
-	width = texture.width;
-	height = texture.height;
-	channels = texture.channels;
-	int length = width * height * channels;
-	data = new unsigned char[length];
-	memcpy(data, texture.data, length);
-	return *this;
-}
-
 glm::vec4 Texture2D::sample(const glm::vec2& uv) const
 {
 	glm::vec2 _uv = glm::vec2(glm::clamp(uv.x, 0.0f, 1.0f), glm::clamp(uv.y, 0.0f, 1.0f));
@@ -40,7 +29,7 @@ glm::vec4 Texture2D::sample(const glm::vec2& uv) const
 		float r = data[offset + 0];
 		float g = data[offset + 1];
 		float b = data[offset + 2];
-		float a = data[offset + 3];
+		float a = channels == 4 ? data[offset + 3] : 255.0f;
 		glm::vec4 color = glm::vec4(r, g, b, a) / 255.0f;
 		return color;
 	}
@@ -0,0 +1,183 @@
+#include "TileCache.hpp"
+#include <assert.h>
+#include <type_traits>
+#include <utility>
+
+#include "Profiler.hpp"
+
+namespace
+{
+	template<typename T>
+	void hashValue(uint64_t& hash, const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "hashed by bytes");
+		hash = TileCache::hashBytes(&value, sizeof(value), hash);
+	}
+}
+
+TileCache::TileCache(Renderer & renderer, const int tileSize)
+	:renderer(renderer), tileSize(tileSize)
+{
+	assert(tileSize > 0);
+}
+
+void TileCache::begin()
+{
+	drawCount = 0;
+}
+
+void TileCache::submit(const DrawPacket & packet, const uint64_t inputHash)
+{
+	assert(packet.pipeline.shader);
+	if (drawCount == (int)draws.size())
+	{
+		draws.emplace_back();
+	}
+	Draw& draw = draws[drawCount++];
+	draw.packet = packet;
+	draw.packet.pipeline.tileMask = nullptr;
+	uint64_t hash = hashPipeline(packet.pipeline);
+	hashValue(hash, inputHash);
+	draw.inputHash = hash;
+}
+
+int TileCache::end()
+{
+	SR_PROFILE_SCOPE("tiles");
+	const int width = renderer.getWidth();
+	const int height = renderer.getHeight();
+	if (dirtyTiles.getWidth() != width || dirtyTiles.getHeight() != height || dirtyTiles.getTileSize() != tileSize)
+	{
+		isValid = false;
+	}
+	dirtyTiles.resize(width, height, tileSize);
+
+	for (int i = 0; i < drawCount; i++)
+	{
+		Draw& draw = draws[i];
+		const bool hasPrevious = isValid && i < previousDrawCount;
+		if (hasPrevious && previousDraws[i].inputHash == draw.inputHash)
+		{
+			draw.coverage = previousDraws[i].coverage;
+			continue;
+		}
+		if (draw.packet.bindUniforms)
+		{
+			draw.packet.bindUniforms();
+		}
+		draw.coverage.resize(width, height, tileSize);
+		renderer.coverage(draw.packet.pipeline, draw.coverage);
+		dirtyTiles.add(draw.coverage);
+		if (hasPrevious)
+		{
+			dirtyTiles.add(previousDraws[i].coverage);
+		}
+	}
+	if (isValid)
+	{
+		for (int i = drawCount; i < previousDrawCount; i++)
+		{
+			dirtyTiles.add(previousDraws[i].coverage);
+		}
+	}
+	else
+	{
+		dirtyTiles.fill();
+	}
+
+	const int dirtyCount = dirtyTiles.count();
+	// Also resets the frame arena the coverage passes allocated from.
+	renderer.flush(dirtyTiles, clearColor);
+	if (dirtyCount > 0)
+	{
+		// A full redraw skips the per pixel tile test.
+		const TileMask* tileMask = dirtyCount == dirtyTiles.getColumns() * dirtyTiles.getRows() ? nullptr : &dirtyTiles;
+		for (int i = 0; i < drawCount; i++)
+		{
+			Draw& draw = draws[i];
+			if (draw.coverage.intersects(dirtyTiles) == false)
+			{
+				continue;
+			}
+			if (draw.packet.bindUniforms)
+			{
+				draw.packet.bindUniforms();
+			}
+			draw.packet.pipeline.tileMask = tileMask;
+			renderer.pipeline(draw.packet.pipeline);
+		}
+	}
+
+	std::swap(draws, previousDraws);
+	previousDrawCount = drawCount;
+	drawCount = 0;
+	isValid = true;
+	return dirtyCount;
+}
+
+void TileCache::invalidate()
+{
+	isValid = false;
+}
+
+const TileMask & TileCache::getDirtyTiles() const
+{
+	return dirtyTiles;
+}
+
+uint64_t TileCache::hashInputs(const Mesh * mesh, const glm::mat4x4 & transform, const uint64_t materialHash)
+{
+	uint64_t hash = hashBytes(&mesh, sizeof(mesh));
+	hashValue(hash, transform);
+	hashValue(hash, materialHash);
+	return hash;
+}
+
+uint64_t TileCache::hashBytes(const void * data, const size_t size, uint64_t hash)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+uint64_t TileCache::hashPipeline(const RenderPipeline & pipeline)
+{
+	// Field by field: padding bytes of the structs are indeterminate. tileMask is set by the cache itself.
+	uint64_t hash = hashBytes(&pipeline.shader, sizeof(pipeline.shader));
+	const DepthStencilState& depthStencil = pipeline.depthStencil;
+	hashValue(hash, depthStencil.depthCompare);
+	hashValue(hash, depthStencil.isDepthWriteEnabled);
+	hashValue(hash, depthStencil.isStencilEnabled);
+	hashValue(hash, depthStencil.stencilCompare);
+	hashValue(hash, depthStencil.stencilReference);
+	hashValue(hash, depthStencil.stencilReadMask);
+	hashValue(hash, depthStencil.stencilWriteMask);
+	hashValue(hash, depthStencil.stencilFailOp);
+	hashValue(hash, depthStencil.depthFailOp);
+	hashValue(hash, depthStencil.passOp);
+	hashValue(hash, pipeline.vertexBuffer);
+	hashValue(hash, pipeline.triangleCount);
+	hashValue(hash, pipeline.indexBuffer);
+	hashValue(hash, pipeline.vertexCount);
+	for (int i = 0; i < pipeline.vertexLayout.getAttributeCount(); i++)
+	{
+		const VertexAttribute& attribute = pipeline.vertexLayout.getAttribute(i);
+		hashValue(hash, attribute.stream);
+		hashValue(hash, attribute.stride);
+		hashValue(hash, attribute.offset);
+		hashValue(hash, attribute.format);
+	}
+	hashValue(hash, pipeline.instanceCount);
+	hashValue(hash, pipeline.instanceBuffer);
+	hashValue(hash, pipeline.instanceStride);
+	hashValue(hash, pipeline.viewport);
+	hashValue(hash, pipeline.scissor);
+	hashValue(hash, pipeline.isDepthOnly);
+	hashValue(hash, pipeline.shadingRate);
+	hashValue(hash, pipeline.shadingRateTiles);
+	hashValue(hash, pipeline.shadingRateTileSize);
+	return hash;
+}
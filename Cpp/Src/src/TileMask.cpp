@@ -0,0 +1,180 @@
+#include "TileMask.hpp"
+#include <assert.h>
+#include <algorithm>
+
+TileMask::TileMask()
+{
+
+}
+
+TileMask::TileMask(const int width, const int height, const int tileSize)
+{
+	resize(width, height, tileSize);
+}
+
+int TileMask::getWidth() const
+{
+	return width;
+}
+
+int TileMask::getHeight() const
+{
+	return height;
+}
+
+int TileMask::getTileSize() const
+{
+	return tileSize;
+}
+
+int TileMask::getColumns() const
+{
+	return columns;
+}
+
+int TileMask::getRows() const
+{
+	return rows;
+}
+
+void TileMask::resize(const int width, const int height, const int tileSize)
+{
+	assert(width >= 0 && height >= 0 && tileSize > 0);
+	this->width = width;
+	this->height = height;
+	this->tileSize = tileSize;
+	columns = (width + tileSize - 1) / tileSize;
+	rows = (height + tileSize - 1) / tileSize;
+	tiles.assign((size_t)columns * rows, 0);
+}
+
+void TileMask::clear()
+{
+	std::fill(tiles.begin(), tiles.end(), (unsigned char)0);
+}
+
+void TileMask::fill()
+{
+	std::fill(tiles.begin(), tiles.end(), (unsigned char)1);
+}
+
+bool TileMask::isEmpty() const
+{
+	return std::find(tiles.begin(), tiles.end(), (unsigned char)1) == tiles.end();
+}
+
+int TileMask::count() const
+{
+	return (int)std::count(tiles.begin(), tiles.end(), (unsigned char)1);
+}
+
+bool TileMask::isSet(const int column, const int row) const
+{
+	assert(column >= 0 && column < columns && row >= 0 && row < rows);
+	return tiles[(size_t)row * columns + column] != 0;
+}
+
+void TileMask::set(const int column, const int row)
+{
+	assert(column >= 0 && column < columns && row >= 0 && row < rows);
+	tiles[(size_t)row * columns + column] = 1;
+}
+
+bool TileMask::containsPixel(const int x, const int y) const
+{
+	assert(x >= 0 && x < width && y >= 0 && y < height);
+	return tiles[(size_t)(y / tileSize) * columns + x / tileSize] != 0;
+}
+
+void TileMask::addRect(const PixelRect & rect)
+{
+	const PixelRect clipped = rect.intersect(PixelRect{ 0, 0, width, height });
+	if (clipped.isEmpty())
+	{
+		return;
+	}
+	const int lastColumn = (clipped.x + clipped.width - 1) / tileSize;
+	const int lastRow = (clipped.y + clipped.height - 1) / tileSize;
+	for (int row = clipped.y / tileSize; row <= lastRow; row++)
+	{
+		std::fill_n(tiles.begin() + (size_t)row * columns + clipped.x / tileSize, lastColumn - clipped.x / tileSize + 1, (unsigned char)1);
+	}
+}
+
+void TileMask::add(const TileMask & other)
+{
+	assert(other.width == width && other.height == height && other.tileSize == tileSize);
+	for (size_t i = 0; i < tiles.size(); i++)
+	{
+		tiles[i] |= other.tiles[i];
+	}
+}
+
+bool TileMask::intersects(const TileMask & other) const
+{
+	assert(other.width == width && other.height == height && other.tileSize == tileSize);
+	for (size_t i = 0; i < tiles.size(); i++)
+	{
+		if (tiles[i] & other.tiles[i])
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool TileMask::intersects(const PixelRect & rect) const
+{
+	const PixelRect clipped = rect.intersect(PixelRect{ 0, 0, width, height });
+	if (clipped.isEmpty())
+	{
+		return false;
+	}
+	const int firstColumn = clipped.x / tileSize;
+	const int lastColumn = (clipped.x + clipped.width - 1) / tileSize;
+	const int lastRow = (clipped.y + clipped.height - 1) / tileSize;
+	for (int row = clipped.y / tileSize; row <= lastRow; row++)
+	{
+		const unsigned char* first = tiles.data() + (size_t)row * columns + firstColumn;
+		const unsigned char* last = tiles.data() + (size_t)row * columns + lastColumn + 1;
+		if (std::find(first, last, (unsigned char)1) != last)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+PixelRect TileMask::getTileRect(const int column, const int row) const
+{
+	assert(column >= 0 && column < columns && row >= 0 && row < rows);
+	const PixelRect tile = { column * tileSize, row * tileSize, tileSize, tileSize };
+	return tile.intersect(PixelRect{ 0, 0, width, height });
+}
+
+PixelRect TileMask::getBounds() const
+{
+	int firstColumn = columns;
+	int lastColumn = -1;
+	int firstRow = rows;
+	int lastRow = -1;
+	for (int row = 0; row < rows; row++)
+	{
+		for (int column = 0; column < columns; column++)
+		{
+			if (tiles[(size_t)row * columns + column])
+			{
+				firstColumn = std::min(firstColumn, column);
+				lastColumn = std::max(lastColumn, column);
+				firstRow = std::min(firstRow, row);
+				lastRow = std::max(lastRow, row);
+			}
+		}
+	}
+	if (lastColumn < 0)
+	{
+		return PixelRect();
+	}
+	const PixelRect bounds = { firstColumn * tileSize, firstRow * tileSize, (lastColumn - firstColumn + 1) * tileSize, (lastRow - firstRow + 1) * tileSize };
+	return bounds.intersect(PixelRect{ 0, 0, width, height });
+}
@@ -20,6 +20,15 @@ glm::vec3 randomColor()
 	return color;
 }
 
+glm::vec3 heatmapColor(const double t)
+{
+	const glm::vec3 colors[5] = { Color::blue, glm::vec3(0.0, 1.0, 1.0), Color::gree, Color::yellow, Color::red };
+	const double x = glm::clamp(t, 0.0, 1.0) * 4.0;
+	const int index = glm::min((int)x, 3);
+	const float f = (float)(x - index);
+	return colors[index] * (1.0f - f) + colors[index + 1] * f;
+}
+
 std::string getFolder(const std::string filename)
 {
 	const std::filesystem::path path(filename);
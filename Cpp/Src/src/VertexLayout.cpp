@@ -0,0 +1,148 @@
+#include "VertexLayout.hpp"
+#include <assert.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SR_VERTEX_LAYOUT_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	/*
+	Each format has its own loop so the branch on the format is taken once per attribute and block, not per vertex.
+	*/
+	void gatherFloat(const char* source, const int stride, const int componentCount, const int count, glm::vec4* out, const int outStride)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			const float* element = reinterpret_cast<const float*>(source + (size_t)i * stride);
+			glm::vec4 value(0.0f, 0.0f, 0.0f, 1.0f);
+			for (int c = 0; c < componentCount; c++)
+			{
+				value[c] = element[c];
+			}
+			out[(size_t)i * outStride] = value;
+		}
+	}
+
+	void gatherFloat3(const char* source, const int stride, const int count, glm::vec4* out, const int outStride)
+	{
+		int i = 0;
+#if defined(SR_VERTEX_LAYOUT_SSE2)
+		// Loads 4 floats and replaces the 4th with 1.0. The last element is left to the scalar loop so the
+		// load never reads past the end of the stream.
+		const __m128 xyzMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+		const __m128 wOne = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+		for (; i + 1 < count; i++)
+		{
+			const __m128 value = _mm_loadu_ps(reinterpret_cast<const float*>(source + (size_t)i * stride));
+			_mm_storeu_ps(&out[(size_t)i * outStride].x, _mm_or_ps(_mm_and_ps(value, xyzMask), wOne));
+		}
+#endif
+		for (; i < count; i++)
+		{
+			const float* element = reinterpret_cast<const float*>(source + (size_t)i * stride);
+			out[(size_t)i * outStride] = glm::vec4(element[0], element[1], element[2], 1.0f);
+		}
+	}
+
+	void gatherFloat4(const char* source, const int stride, const int count, glm::vec4* out, const int outStride)
+	{
+		for (int i = 0; i < count; i++)
+		{
+#if defined(SR_VERTEX_LAYOUT_SSE2)
+			_mm_storeu_ps(&out[(size_t)i * outStride].x, _mm_loadu_ps(reinterpret_cast<const float*>(source + (size_t)i * stride)));
+#else
+			const float* element = reinterpret_cast<const float*>(source + (size_t)i * stride);
+			out[(size_t)i * outStride] = glm::vec4(element[0], element[1], element[2], element[3]);
+#endif
+		}
+	}
+
+	void gatherUnorm8x4(const char* source, const int stride, const int count, glm::vec4* out, const int outStride)
+	{
+		const float scale = 1.0f / 255.0f;
+		for (int i = 0; i < count; i++)
+		{
+			const unsigned char* element = reinterpret_cast<const unsigned char*>(source + (size_t)i * stride);
+			out[(size_t)i * outStride] = glm::vec4(element[0], element[1], element[2], element[3]) * scale;
+		}
+	}
+}
+
+void VertexLayout::addAttribute(const void * stream, const int stride, const int offset, const VertexFormat format)
+{
+	assert(stream && stride > 0 && offset >= 0);
+	assert((int)attributes.size() < maxAttributeCount);
+	VertexAttribute attribute;
+	attribute.stream = stream;
+	attribute.stride = stride;
+	attribute.offset = offset;
+	attribute.format = format;
+	attributes.push_back(attribute);
+}
+
+void VertexLayout::clear()
+{
+	attributes.clear();
+}
+
+bool VertexLayout::isEmpty() const
+{
+	return attributes.empty();
+}
+
+int VertexLayout::getAttributeCount() const
+{
+	return (int)attributes.size();
+}
+
+const VertexAttribute & VertexLayout::getAttribute(const int index) const
+{
+	assert(index >= 0 && index < (int)attributes.size());
+	return attributes[index];
+}
+
+void VertexLayout::gather(const int firstVertex, const int count, glm::vec4 * out) const
+{
+	const int outStride = (int)attributes.size();
+	for (int a = 0; a < outStride; a++)
+	{
+		const VertexAttribute& attribute = attributes[a];
+		const char* source = static_cast<const char*>(attribute.stream) + attribute.offset + (size_t)firstVertex * attribute.stride;
+		switch (attribute.format)
+		{
+		case VertexFormat::float1:
+		case VertexFormat::float2:
+			gatherFloat(source, attribute.stride, componentCount(attribute.format), count, out + a, outStride);
+			break;
+		case VertexFormat::float3:
+			gatherFloat3(source, attribute.stride, count, out + a, outStride);
+			break;
+		case VertexFormat::float4:
+			gatherFloat4(source, attribute.stride, count, out + a, outStride);
+			break;
+		case VertexFormat::unorm8x4:
+			gatherUnorm8x4(source, attribute.stride, count, out + a, outStride);
+			break;
+		}
+	}
+}
+
+int VertexLayout::componentCount(const VertexFormat format)
+{
+	switch (format)
+	{
+	case VertexFormat::float1:
+		return 1;
+	case VertexFormat::float2:
+		return 2;
+	case VertexFormat::float3:
+		return 3;
+	case VertexFormat::float4:
+		return 4;
+	case VertexFormat::unorm8x4:
+		return 4;
+	}
+	return 0;
+}
@@ -8,24 +8,73 @@ add_requires("glad")
 add_requires("glfw")
 add_requires("glm")
 add_requires("stb")
+add_requires("zlib")
+
+option("profiling")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Enable pipeline statistics and Chrome trace stage timers")
+    add_defines("SR_ENABLE_PROFILING")
+option_end()
 
 rule("CopyResource")
     after_build(function (target)
         os.cp("../Resource", path.join(target:targetdir(), "Resource"))
     end)
 
+target("SoftwareRenderingCore")
+    set_kind("static")
+    set_languages("c++17")
+    add_files("Src/src/**.cpp")
+    add_headerfiles("Src/include/**.hpp")
+    add_includedirs("Src/include/SoftwareRendering", {public = true})
+    add_includedirs("Src/include/SoftwareRendering/Shader", {public = true})
+    add_rules("mode.debug", "mode.release")
+    add_options("profiling")
+    add_packages("spdlog", {public = true})
+    add_packages("glm", {public = true})
+    add_packages("stb", {public = true})
+    add_packages("assimp", {public = true})
+    add_packages("zlib", {public = true})
+    if is_plat("linux") then
+        add_syslinks("pthread", "rt", {public = true})
+    end
+
 target("SoftwareRendering")
     set_kind("binary")
     set_languages("c++17")
-    add_files("Src/**.cpp")
-    add_headerfiles("Src/**.hpp")
-    add_includedirs("Src/include/SoftwareRendering")
-    add_includedirs("Src/include/SoftwareRendering/Shader")
+    add_files("Src/main.cpp")
+    add_deps("SoftwareRenderingCore")
     add_rules("mode.debug", "mode.release")
+    add_options("profiling")
     add_rules("CopyResource")
-    add_packages("spdlog")
-    add_packages("assimp")
     add_packages("glad")
     add_packages("glfw")
-    add_packages("glm")
-    add_packages("stb")
+
+-- Windowless batch renderer, must not depend on glfw/glad.
+target("Headless")
+    set_kind("binary")
+    set_languages("c++17")
+    add_files("Headless/**.cpp")
+    add_deps("SoftwareRenderingCore")
+    add_rules("mode.debug", "mode.release")
+    add_options("profiling")
+    add_rules("CopyResource")
+
+target("Benchmark")
+    set_kind("binary")
+    set_languages("c++17")
+    add_files("Benchmark/**.cpp")
+    add_deps("SoftwareRenderingCore")
+    add_rules("mode.debug", "mode.release")
+    add_options("profiling")
+    add_rules("CopyResource")
+
+-- Offline .dae/.fbx to .srmesh converter, see MeshFile.hpp.
+target("MeshConverter")
+    set_kind("binary")
+    set_languages("c++17")
+    add_files("MeshConverter/**.cpp")
+    add_deps("SoftwareRenderingCore")
+    add_rules("mode.debug", "mode.release")
+    add_options("profiling")